@@ -0,0 +1,332 @@
+/* ------------------------------------------------------------------
+   simplesid: Python bindings for the SID emulator.
+
+   Output goes straight into any writable, C-contiguous buffer of
+   int16 ('h') or float32 ('f') items, e.g. a NumPy array, with no
+   copies. Register events are passed in bulk as an int32 buffer with
+   EVENT_COLUMNS columns per row: cycles, then the sidRegs_t fields in
+   declaration order (see REG_FIELDS). The GIL is released while
+   rendering, so separate Sid objects render concurrently from
+   Python threads.
+
+       import numpy as np, simplesid
+       chip = simplesid.Sid(44100)
+       out = np.zeros(44100, dtype=np.int16)
+       n = chip.render_events(events, out)
+   ------------------------------------------------------------------ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "simple_sid.h"
+
+#define FIELD_NAME(f) #f,
+static const char *const regFields[] = {SID_REG_FIELDS(FIELD_NAME)};
+#undef FIELD_NAME
+
+typedef struct
+{
+    PyObject_HEAD
+    sid_t *sid;        /* SID_ALIGN aligned, so kept out of line */
+    int32_t sampleRate;
+    bool busy;         /* rendering with the GIL released */
+} SidObject;
+
+/* ------------------------------------------------------------------
+   Helpers
+   ------------------------------------------------------------------ */
+/* The last character of a struct-module format, ignoring byte order */
+static char formatCode(const Py_buffer *view)
+{
+    const char *f = view->format ? view->format : "B";
+    size_t n = strlen(f);
+    return n ? f[n - 1] : 'B';
+}
+
+/* Acquire a writable int16/float32 output buffer; sets *bufferType */
+static int getOutput(PyObject *obj, Py_buffer *view, int *bufferType)
+{
+    if (PyObject_GetBuffer(obj, view, PyBUF_WRITABLE | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0)
+        return -1;
+
+    char code = formatCode(view);
+    if (code == 'h' && view->itemsize == 2)
+        *bufferType = BUFFER_INT16;
+    else if (code == 'f' && view->itemsize == 4)
+        *bufferType = BUFFER_FLOAT;
+    else
+    {
+        PyErr_SetString(PyExc_TypeError, "output must be an int16 or float32 buffer");
+        PyBuffer_Release(view);
+        return -1;
+    }
+    return 0;
+}
+
+/* Mark the chip busy for a render; fails if it is uninitialised or in use */
+static int claim(SidObject *self)
+{
+    if (!self->sid)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Sid is not initialised (__init__ was not called)");
+        return -1;
+    }
+    if (self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Sid is already rendering in another thread");
+        return -1;
+    }
+    self->busy = true;
+    return 0;
+}
+
+/* ------------------------------------------------------------------
+   Sid type
+   ------------------------------------------------------------------ */
+static int Sid_init(SidObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"sample_rate", NULL};
+    int sampleRate = 44100;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &sampleRate))
+        return -1;
+    if (sampleRate <= 0 || sampleRate > SID_CLOCK_PAL)
+    {
+        PyErr_SetString(PyExc_ValueError, "sample_rate out of range");
+        return -1;
+    }
+    /* Re-running __init__ resets the chip, so not under a render */
+    if (self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Sid is already rendering in another thread");
+        return -1;
+    }
+    if (!self->sid)
+    {
+        self->sid = (sid_t *)aligned_alloc(SID_ALIGN, sizeof(sid_t));
+        if (!self->sid)
+        {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
+    self->sampleRate = sampleRate;
+    sidInit(self->sid, sampleRate);
+    return 0;
+}
+
+static void Sid_dealloc(SidObject *self)
+{
+    free(self->sid);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *Sid_reset(SidObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (claim(self) < 0)
+        return NULL;
+    sidInit(self->sid, self->sampleRate);
+    self->busy = false;
+    Py_RETURN_NONE;
+}
+
+/* render(out, cycles, regs, zero=True) -> samples written */
+static PyObject *Sid_render(SidObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"out", "cycles", "regs", "zero", NULL};
+    PyObject *outObj;
+    PyObject *regsObj;
+    int cycles;
+    int zero = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OiO|p", kwlist, &outObj, &cycles, &regsObj, &zero))
+        return NULL;
+
+    PyObject *seq = PySequence_Fast(regsObj, "regs must be a sequence of register values");
+    if (!seq)
+        return NULL;
+    if (PySequence_Fast_GET_SIZE(seq) != SID_NUM_REG_FIELDS)
+    {
+        Py_DECREF(seq);
+        return PyErr_Format(PyExc_ValueError, "regs must have %d values", SID_NUM_REG_FIELDS);
+    }
+    int32_t row[SID_NUM_REG_FIELDS];
+    for (int i = 0; i < SID_NUM_REG_FIELDS; i++)
+    {
+        long v = PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i));
+        if (v == -1 && PyErr_Occurred())
+        {
+            Py_DECREF(seq);
+            return NULL;
+        }
+        row[i] = (int32_t)v;
+    }
+    Py_DECREF(seq);
+
+    sidRegs_t regs;
+    sidRegsFromRow(&regs, row);
+
+    Py_buffer out;
+    int bufferType;
+    if (getOutput(outObj, &out, &bufferType) < 0)
+        return NULL;
+    if (claim(self) < 0)
+    {
+        PyBuffer_Release(&out);
+        return NULL;
+    }
+
+    int32_t maxSamples = (int32_t)((out.len / out.itemsize > INT32_MAX) ? INT32_MAX : out.len / out.itemsize);
+    int32_t n;
+    Py_BEGIN_ALLOW_THREADS
+    n = bufferSamplesSid(self->sid, cycles, &regs, out.buf, maxSamples, bufferType, zero != 0);
+    Py_END_ALLOW_THREADS
+
+    self->busy = false;
+    PyBuffer_Release(&out);
+    return PyLong_FromLong(n);
+}
+
+/* render_events(events, out) -> samples written */
+static PyObject *Sid_render_events(SidObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"events", "out", NULL};
+    PyObject *eventsObj;
+    PyObject *outObj;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO", kwlist, &eventsObj, &outObj))
+        return NULL;
+
+    Py_buffer ev;
+    if (PyObject_GetBuffer(eventsObj, &ev, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0)
+        return NULL;
+    char code = formatCode(&ev);
+    if (ev.itemsize != 4 || (code != 'i' && code != 'l'))
+    {
+        PyBuffer_Release(&ev);
+        PyErr_SetString(PyExc_TypeError, "events must be an int32 buffer");
+        return NULL;
+    }
+    Py_ssize_t items = ev.len / ev.itemsize;
+    if (items % SID_EVENT_COLUMNS != 0 || (ev.ndim == 2 && ev.shape[1] != SID_EVENT_COLUMNS))
+    {
+        PyBuffer_Release(&ev);
+        return PyErr_Format(PyExc_ValueError, "events must have %d columns per row", SID_EVENT_COLUMNS);
+    }
+    Py_ssize_t numEvents = items / SID_EVENT_COLUMNS;
+    if (numEvents > INT32_MAX)
+    {
+        PyBuffer_Release(&ev);
+        PyErr_SetString(PyExc_OverflowError, "too many events");
+        return NULL;
+    }
+
+    Py_buffer out;
+    int bufferType;
+    if (getOutput(outObj, &out, &bufferType) < 0)
+    {
+        PyBuffer_Release(&ev);
+        return NULL;
+    }
+    if (claim(self) < 0)
+    {
+        PyBuffer_Release(&out);
+        PyBuffer_Release(&ev);
+        return NULL;
+    }
+
+    int32_t maxSamples = (int32_t)((out.len / out.itemsize > INT32_MAX) ? INT32_MAX : out.len / out.itemsize);
+    size_t sampleSize = (size_t)out.itemsize;
+    int32_t produced = 0;
+    Py_BEGIN_ALLOW_THREADS
+    const int32_t *row = (const int32_t *)ev.buf;
+    for (Py_ssize_t i = 0; i < numEvents && produced < maxSamples; i++, row += SID_EVENT_COLUMNS)
+    {
+        sidRegs_t regs;
+        sidRegsFromRow(&regs, row + 1);
+        produced += bufferSamplesSid(self->sid, row[0], &regs,
+                                     (char *)out.buf + (size_t)produced * sampleSize,
+                                     maxSamples - produced, bufferType, true);
+    }
+    Py_END_ALLOW_THREADS
+
+    self->busy = false;
+    PyBuffer_Release(&out);
+    PyBuffer_Release(&ev);
+    return PyLong_FromLong(produced);
+}
+
+static PyObject *Sid_get_sample_rate(SidObject *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromLong(self->sampleRate);
+}
+
+static PyMethodDef Sid_methods[] = {
+    {"render", (PyCFunction)(void (*)(void))Sid_render, METH_VARARGS | METH_KEYWORDS,
+     "render(out, cycles, regs, zero=True) -> int\n\n"
+     "Run the chip for 'cycles' CPU cycles with the register values 'regs'\n"
+     "(a sequence in REG_FIELDS order), writing samples into 'out'."},
+    {"render_events", (PyCFunction)(void (*)(void))Sid_render_events, METH_VARARGS | METH_KEYWORDS,
+     "render_events(events, out) -> int\n\n"
+     "Render an int32 event array with EVENT_COLUMNS columns per row\n"
+     "(cycles, then REG_FIELDS) into 'out'."},
+    {"reset", (PyCFunction)Sid_reset, METH_NOARGS, "Reset the chip to its power-on state."},
+    {NULL, NULL, 0, NULL}};
+
+static PyGetSetDef Sid_getset[] = {
+    {"sample_rate", (getter)Sid_get_sample_rate, NULL, "Output sample rate in Hz.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}};
+
+static PyTypeObject SidType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "simplesid.Sid",
+    .tp_doc = "Sid(sample_rate=44100): one emulated SID chip.",
+    .tp_basicsize = sizeof(SidObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)Sid_init,
+    .tp_dealloc = (destructor)Sid_dealloc,
+    .tp_methods = Sid_methods,
+    .tp_getset = Sid_getset,
+};
+
+static struct PyModuleDef simplesidModule = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "simplesid",
+    .m_doc = "Python bindings for the simple_sid SID emulator.",
+    .m_size = -1,
+};
+
+PyMODINIT_FUNC PyInit_simplesid(void)
+{
+    if (PyType_Ready(&SidType) < 0)
+        return NULL;
+
+    PyObject *m = PyModule_Create(&simplesidModule);
+    if (!m)
+        return NULL;
+
+    PyObject *fields = PyTuple_New(SID_NUM_REG_FIELDS);
+    if (!fields)
+        goto fail;
+    for (int i = 0; i < SID_NUM_REG_FIELDS; i++)
+        PyTuple_SET_ITEM(fields, i, PyUnicode_FromString(regFields[i]));
+
+    Py_INCREF(&SidType);
+    if (PyModule_AddObject(m, "Sid", (PyObject *)&SidType) < 0)
+    {
+        Py_DECREF(&SidType);
+        Py_DECREF(fields);
+        goto fail;
+    }
+    if (PyModule_AddObject(m, "REG_FIELDS", fields) < 0)
+    {
+        Py_DECREF(fields);
+        goto fail;
+    }
+    if (PyModule_AddIntConstant(m, "EVENT_COLUMNS", SID_EVENT_COLUMNS) < 0 ||
+        PyModule_AddIntConstant(m, "CLOCK_HZ", SID_CLOCK_PAL) < 0)
+        goto fail;
+    return m;
+
+fail:
+    Py_DECREF(m);
+    return NULL;
+}
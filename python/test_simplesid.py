@@ -0,0 +1,226 @@
+"""Tests for the simplesid bindings (make check-python).
+
+Uses only the standard library: array.array and memoryview stand in
+for NumPy arrays, and ctypes calls the C library linked into the
+extension module to get the sidRenderEvents() reference output.
+"""
+import array
+import ctypes
+import os
+import random
+import sys
+import threading
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import simplesid  # noqa: E402
+
+BUFFER_INT16 = 1  # simple_sid.h
+BUFFER_FLOAT = 2
+
+
+class SidRegs(ctypes.Structure):
+    """sidRegs_t: 16-bit frequency and pulse registers, 8-bit others"""
+    _fields_ = [(name, ctypes.c_int16 if name.startswith(("freq", "pulse")) else ctypes.c_int8)
+                for name in simplesid.REG_FIELDS]
+
+
+class SidEvent(ctypes.Structure):
+    _fields_ = [("regs", SidRegs), ("cycles", ctypes.c_int32)]
+
+
+class SidArena(ctypes.Structure):
+    _fields_ = [("slots", ctypes.c_void_p), ("freeList", ctypes.c_void_p),
+                ("inUse", ctypes.c_void_p), ("capacity", ctypes.c_uint32),
+                ("freeCount", ctypes.c_uint32)]
+
+
+def load_library():
+    lib = ctypes.CDLL(simplesid.__file__)
+    lib.sidArenaInit.argtypes = [ctypes.POINTER(SidArena), ctypes.c_uint32]
+    lib.sidArenaInit.restype = ctypes.c_bool
+    lib.sidArenaAlloc.argtypes = [ctypes.POINTER(SidArena), ctypes.c_int32]
+    lib.sidArenaAlloc.restype = ctypes.c_void_p
+    lib.sidArenaDestroy.argtypes = [ctypes.POINTER(SidArena)]
+    lib.sidRegsFromRow.argtypes = [ctypes.POINTER(SidRegs), ctypes.POINTER(ctypes.c_int32)]
+    lib.sidRenderEvents.argtypes = [ctypes.c_void_p, ctypes.POINTER(SidEvent), ctypes.c_int32,
+                                    ctypes.c_void_p, ctypes.c_int32, ctypes.c_int]
+    lib.sidRenderEvents.restype = ctypes.c_int32
+    return lib
+
+
+def make_events(count, seed, min_cycles=500, max_cycles=20000):
+    """A flat int32 array of 'count' random event rows"""
+    rng = random.Random(seed)
+    rows = array.array("i")
+    for _ in range(count):
+        rows.append(rng.randint(min_cycles, max_cycles))
+        for name in simplesid.REG_FIELDS:
+            if name.startswith("freq"):
+                rows.append(rng.randint(0, 0xffff) - 0x8000)
+            elif name.startswith("pulse"):
+                rows.append(rng.randint(0, 0x0fff))
+            elif name.startswith("waveform"):
+                rows.append(rng.choice([0x11, 0x21, 0x41, 0x81, 0x15, 0x23, 0x40, 0x20]))
+            else:
+                rows.append(rng.randint(0, 0xff) - 0x80)
+    return rows
+
+
+class BufferTests(unittest.TestCase):
+    def setUp(self):
+        self.chip = simplesid.Sid(44100)
+        self.events = make_events(8, seed=1)
+        self.regs = list(self.events[1:simplesid.EVENT_COLUMNS])
+
+    def test_rejects_wrong_dtype(self):
+        for code in "dbiBH":
+            out = array.array(code, bytes(4096))
+            with self.assertRaises(TypeError, msg=code):
+                self.chip.render(out, 10000, self.regs)
+            with self.assertRaises(TypeError, msg=code):
+                self.chip.render_events(self.events, out)
+        out = array.array("h", bytes(4096))
+        for code in "hfq":
+            events = array.array(code, [0] * simplesid.EVENT_COLUMNS)
+            with self.assertRaises(TypeError, msg=code):
+                self.chip.render_events(events, out)
+
+    def test_rejects_read_only_output(self):
+        with self.assertRaises(BufferError):
+            self.chip.render(bytes(4096), 10000, self.regs)
+
+    def test_rejects_non_contiguous(self):
+        out = memoryview(array.array("h", bytes(8192)))[::2]
+        with self.assertRaises(BufferError):
+            self.chip.render(out, 10000, self.regs)
+        with self.assertRaises(BufferError):
+            self.chip.render_events(self.events, out)
+        doubled = array.array("i", [v for v in self.events for _ in range(2)])
+        with self.assertRaises(BufferError):
+            self.chip.render_events(memoryview(doubled)[::2], array.array("h", bytes(8192)))
+
+    def test_rejects_bad_rows(self):
+        out = array.array("h", bytes(8192))
+        with self.assertRaises(ValueError):
+            self.chip.render_events(self.events[:-1], out)
+        # A whole number of rows in total, but the wrong row width
+        columns = simplesid.EVENT_COLUMNS
+        wide = memoryview(array.array("i", [0] * (columns * (columns + 1)))).cast("B").cast(
+            "i", [columns, columns + 1])
+        with self.assertRaises(ValueError):
+            self.chip.render_events(wide, out)
+        with self.assertRaises(ValueError):
+            self.chip.render(out, 10000, self.regs[:-1])
+
+    def test_flat_rows_match_2d_rows(self):
+        flat = array.array("h", bytes(2 * 8192))
+        rows = array.array("h", bytes(2 * 8192))
+        n = self.chip.render_events(self.events, flat)
+        shaped = memoryview(self.events).cast("B").cast(
+            "i", [len(self.events) // simplesid.EVENT_COLUMNS, simplesid.EVENT_COLUMNS])
+        other = simplesid.Sid(44100)
+        m = other.render_events(shaped, rows)
+        self.assertGreater(n, 0)
+        self.assertEqual(n, m)
+        self.assertEqual(flat[:n], rows[:m])
+
+
+class ThreadTests(unittest.TestCase):
+    def test_busy_claim(self):
+        """A second render on a chip that is rendering raises, and the
+        first render finishes unharmed"""
+        chip = simplesid.Sid(44100)
+        events = make_events(40, seed=2, min_cycles=200000, max_cycles=300000)
+        out = array.array("f", bytes(4 * 500000))
+        small = array.array("h", bytes(2 * 64))
+        regs = list(events[1:simplesid.EVENT_COLUMNS])
+        result = {}
+
+        def render():
+            result["n"] = chip.render_events(events, out)
+
+        worker = threading.Thread(target=render)
+        worker.start()
+        rejected = None
+        tries = 0
+        while worker.is_alive() and rejected is None and tries < 1000:
+            tries += 1
+            try:
+                chip.render(small, 100, regs)
+            except RuntimeError as e:
+                rejected = e
+        worker.join()
+
+        self.assertIsNotNone(rejected, "render finished before it could be interrupted")
+        self.assertIn("already rendering", str(rejected))
+        self.assertGreater(result["n"], 0)
+        # The chip is free again
+        self.assertGreaterEqual(chip.render(small, 100, regs), 0)
+
+    def test_separate_chips_render_concurrently(self):
+        events = make_events(40, seed=3)
+        outs = [array.array("h", bytes(2 * 65536)) for _ in range(4)]
+        counts = [0] * 4
+
+        def render(i):
+            counts[i] = simplesid.Sid(44100).render_events(events, outs[i])
+
+        threads = [threading.Thread(target=render, args=(i,)) for i in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertTrue(all(n == counts[0] and n > 0 for n in counts))
+        self.assertTrue(all(o == outs[0] for o in outs))
+
+
+class ReferenceTests(unittest.TestCase):
+    """render_events() against sidRenderEvents() called directly"""
+
+    @classmethod
+    def setUpClass(cls):
+        cls.lib = load_library()
+
+    def reference(self, rows, buffer_type, max_samples):
+        columns = simplesid.EVENT_COLUMNS
+        count = len(rows) // columns
+        events = (SidEvent * count)()
+        values = (ctypes.c_int32 * columns)()
+        for i in range(count):
+            values[:] = rows[i * columns:(i + 1) * columns]
+            events[i].cycles = values[0]
+            self.lib.sidRegsFromRow(ctypes.byref(events[i].regs),
+                                    ctypes.cast(ctypes.byref(values, 4), ctypes.POINTER(ctypes.c_int32)))
+
+        arena = SidArena()
+        self.assertTrue(self.lib.sidArenaInit(ctypes.byref(arena), 1))
+        try:
+            sid = self.lib.sidArenaAlloc(ctypes.byref(arena), 44100)
+            out = array.array("h" if buffer_type == BUFFER_INT16 else "f", bytes(4 * max_samples))
+            address, _ = out.buffer_info()
+            n = self.lib.sidRenderEvents(sid, events, count, address, max_samples, buffer_type)
+        finally:
+            self.lib.sidArenaDestroy(ctypes.byref(arena))
+        return n, out
+
+    def check(self, code, buffer_type, max_samples):
+        rows = make_events(120, seed=4)
+        n, expected = self.reference(rows, buffer_type, max_samples)
+        out = array.array(code, bytes(4 * max_samples))
+        m = simplesid.Sid(44100).render_events(rows, memoryview(out)[:max_samples])
+        self.assertEqual(n, m)
+        self.assertEqual(expected[:n].tobytes(), out[:m].tobytes())
+
+    def test_int16_matches_c(self):
+        self.check("h", BUFFER_INT16, 65536)
+
+    def test_float_matches_c(self):
+        self.check("f", BUFFER_FLOAT, 65536)
+
+    def test_short_buffer_matches_c(self):
+        self.check("h", BUFFER_INT16, 5000)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,138 @@
+#include "sid_analysis.h"
+
+/* Hz per unit of the frequency register: clock / 2^24 */
+#define SID_HZ_PER_REG ((float)SID_CLOCK_PAL / 16777216.f)
+
+static void startBlock(sidAnalysis_t *an)
+{
+    memset(&an->current, 0, sizeof(an->current));
+    an->current.firstSample = an->sampleCount;
+    an->sumSquares = 0.0;
+}
+
+static void emitBlock(sidAnalysis_t *an)
+{
+    sidBlockStats_t *b = &an->current;
+    if (b->numSamples == 0)
+        return;
+    b->rms = (float)sqrt(an->sumSquares / b->numSamples);
+    if (an->numBlocks < an->blockCapacity)
+        an->blocks[an->numBlocks++] = *b;
+    else
+        an->droppedBlocks++;
+    startBlock(an);
+}
+
+static void emitNote(sidAnalysis_t *an, const sidChannel_t *ch, uint8_t voice,
+                     sidNoteEventType_t type)
+{
+    if (an->numEvents >= an->eventCapacity)
+    {
+        an->droppedEvents++;
+        return;
+    }
+    sidNoteEvent_t *e = &an->events[an->numEvents++];
+    memset(e, 0, sizeof(*e));
+    e->sample = an->sampleCount;
+    e->hz = ch->frequency * SID_HZ_PER_REG;
+    e->frequency = ch->frequency;
+    e->voice = voice;
+    e->type = (uint8_t)type;
+    e->waveform = ch->waveform;
+}
+
+/* ------------------------------------------------------------------
+   Init. Either output array may be NULL with a capacity of 0.
+   ------------------------------------------------------------------ */
+void sidAnalysisInit(sidAnalysis_t *an,
+                     sidNoteEvent_t *events,
+                     uint32_t eventCapacity,
+                     sidBlockStats_t *blocks,
+                     uint32_t blockCapacity,
+                     uint32_t blockSize)
+{
+    assert(an);
+    assert(blockSize > 0 && blockSize <= 0xffff);
+    memset(an, 0, sizeof(*an));
+    an->events = events;
+    an->eventCapacity = events ? eventCapacity : 0;
+    an->blocks = blocks;
+    an->blockCapacity = blocks ? blockCapacity : 0;
+    an->blockSize = blockSize;
+    startBlock(an);
+}
+
+/* ------------------------------------------------------------------
+   Called by the renderer once per output sample ('out' is the final
+   clamped mix, -1..+1).
+   ------------------------------------------------------------------ */
+void sidAnalysisSample(sidAnalysis_t *an, const sid_t *sid, float out)
+{
+    sidBlockStats_t *b = &an->current;
+
+    for (uint8_t v = 0; v < 3; v++)
+    {
+        const sidChannel_t *ch = &sid->channels[v];
+        bool gate = (ch->waveform & 0x01) != 0;
+        bool wasGated = (an->lastWaveform[v] & 0x01) != 0;
+
+        if (gate && !wasGated)
+            emitNote(an, ch, v, SID_NOTE_ON);
+        else if (!gate && wasGated)
+            emitNote(an, ch, v, SID_NOTE_OFF);
+        else if (gate && ch->frequency != an->lastFrequency[v])
+            emitNote(an, ch, v, SID_NOTE_PITCH);
+        an->lastWaveform[v] = ch->waveform;
+        an->lastFrequency[v] = ch->frequency;
+
+        b->phaseSamples[v][ch->state]++;
+        if (ch->volumeLevel > b->voicePeakLevel[v])
+            b->voicePeakLevel[v] = ch->volumeLevel;
+    }
+
+    float mag = fabsf(out);
+    if (mag > b->peak)
+        b->peak = mag;
+    an->sumSquares += (double)out * out;
+    b->numSamples++;
+    an->sampleCount++;
+
+    if (b->numSamples == an->blockSize)
+        emitBlock(an);
+}
+
+/* Emit the final, partial block */
+void sidAnalysisFlush(sidAnalysis_t *an)
+{
+    assert(an);
+    emitBlock(an);
+}
+
+/* ------------------------------------------------------------------
+   bufferSamplesSid with the analysis sink attached.
+   outSamples may be NULL to analyse without producing audio.
+   ------------------------------------------------------------------ */
+int32_t bufferSamplesSidAnalysis(sid_t *sid,
+                                 int cpuCycles,
+                                 const sidRegs_t *regs,
+                                 void *outSamples,
+                                 int32_t maxSamples,
+                                 int bufferType,
+                                 bool zeroBuffer,
+                                 sidAnalysis_t *an)
+{
+    sidMix_t mix;
+    sidTaps_t taps;
+    if (cpuCycles <= 0 || maxSamples <= 0)
+        return 0;
+    assert(sid);
+    assert(regs);
+    assert(an);
+
+    sidSetRegs(sid, regs);
+    sidMixFromRegs(regs, &mix);
+    memset(&taps, 0, sizeof(taps));
+    taps.analysis = an;
+    return sidRenderTaps(sid, cpuCycles, &mix, outSamples, maxSamples,
+                         bufferType, zeroBuffer, &taps);
+}
@@ -0,0 +1,85 @@
+#ifndef SID_ANALYSIS_H
+#define SID_ANALYSIS_H
+
+#include "simple_sid.h"
+
+/* ------------------------------------------------------------------
+   Analysis sink, fused into the render loop.
+
+   While attached to a render it records, straight from the chip state:
+   - per-voice note events (gate on/off, pitch changes while gated);
+   - per-block statistics: RMS and peak of the mix, and per voice the
+     peak envelope level and samples spent in each envelope phase.
+   Both go into caller-provided arrays; entries that don't fit are
+   counted as dropped. Pass a NULL outSamples to analyse without
+   producing audio.
+   ------------------------------------------------------------------ */
+typedef enum
+{
+    SID_NOTE_ON = 0,
+    SID_NOTE_OFF,
+    SID_NOTE_PITCH
+} sidNoteEventType_t;
+
+typedef struct
+{
+    uint32_t sample;    /* sample index since sidAnalysisInit */
+    float hz;           /* frequency register converted to Hz */
+    uint16_t frequency; /* raw frequency register */
+    uint8_t voice;      /* 0..2 */
+    uint8_t type;       /* sidNoteEventType_t */
+    uint8_t waveform;   /* waveform register at the event */
+    uint8_t reserved[3];
+} sidNoteEvent_t;
+
+typedef struct
+{
+    uint32_t firstSample;
+    uint32_t numSamples;
+    float rms;
+    float peak;
+    uint8_t voicePeakLevel[3];
+    uint8_t reserved;
+    uint16_t phaseSamples[3][3]; /* [voice][ATTACK, DECAY, RELEASE] */
+} sidBlockStats_t;
+
+struct sidAnalysis_s
+{
+    sidNoteEvent_t *events;
+    uint32_t eventCapacity;
+    uint32_t numEvents;
+    uint32_t droppedEvents;
+
+    sidBlockStats_t *blocks;
+    uint32_t blockCapacity;
+    uint32_t numBlocks;
+    uint32_t droppedBlocks;
+    uint32_t blockSize; /* samples per block, <= 65535 */
+
+    /* running state */
+    uint32_t sampleCount;
+    double sumSquares;
+    sidBlockStats_t current;
+    uint16_t lastFrequency[3];
+    uint8_t lastWaveform[3];
+};
+
+void sidAnalysisInit(sidAnalysis_t *an,
+                     sidNoteEvent_t *events,
+                     uint32_t eventCapacity,
+                     sidBlockStats_t *blocks,
+                     uint32_t blockCapacity,
+                     uint32_t blockSize);
+void sidAnalysisSample(sidAnalysis_t *an, const sid_t *sid, float out);
+void sidAnalysisFlush(sidAnalysis_t *an);
+
+int32_t bufferSamplesSidAnalysis(sid_t *sid,
+                                 int cpuCycles,
+                                 const sidRegs_t *regs,
+                                 void *outSamples,
+                                 int32_t maxSamples,
+                                 int bufferType,
+                                 bool zeroBuffer,
+                                 sidAnalysis_t *an);
+
+#endif
@@ -0,0 +1,195 @@
+#include "sid_automation.h"
+
+#define SID_NEVER UINT64_MAX
+
+/* Largest register value for each parameter */
+static const int32_t paramMax[SID_PARAM_COUNT] = {
+    0xffff, 0xffff, 0xffff, /* frequency */
+    0x0fff, 0x0fff, 0x0fff, /* pulse width (12 bits) */
+    0xff,                   /* cutoff */
+    0x0f};                  /* volume */
+
+static int32_t quantise(const sidRamp_t *r, double v)
+{
+    double q = floor(v + 0.5);
+    if (q < 0.0)
+        return 0;
+    if (q > paramMax[r->param])
+        return paramMax[r->param];
+    return (int32_t)q;
+}
+
+/* Ramp value at 'cycle' (startCycle <= cycle) */
+static double rampValue(const sidRamp_t *r, uint64_t cycle)
+{
+    if (cycle >= r->endCycle)
+        return r->to;
+    double t = (double)(cycle - r->startCycle) / (double)(r->endCycle - r->startCycle);
+    if (r->shape == SID_RAMP_EXPONENTIAL)
+        return r->from * exp(t * log(r->to / r->from));
+    return r->from + (r->to - r->from) * t;
+}
+
+/* First cycle after 'cycle' at which the quantised value leaves q */
+static uint64_t rampNextChange(const sidRamp_t *r, uint64_t cycle, int32_t q)
+{
+    if (cycle >= r->endCycle || r->to == r->from)
+        return SID_NEVER;
+
+    double bound = (r->to > r->from) ? q + 0.5 : q - 0.5;
+    double t;
+    if (r->shape == SID_RAMP_EXPONENTIAL)
+    {
+        if (bound <= 0.0)
+            return r->endCycle;
+        t = log(bound / r->from) / log(r->to / r->from);
+    }
+    else
+    {
+        t = (bound - r->from) / (r->to - r->from);
+    }
+
+    double duration = (double)(r->endCycle - r->startCycle);
+    double at = ceil(t * duration);
+    uint64_t next = (at <= 0.0) ? r->startCycle : r->startCycle + (uint64_t)at;
+    if (next <= cycle)
+        next = cycle + 1;
+    if (next > r->endCycle)
+        next = r->endCycle;
+    return next;
+}
+
+void sidAutomationInit(sidAutomation_t *a)
+{
+    assert(a);
+    memset(a, 0, sizeof(*a));
+    sidAutomationClear(a);
+}
+
+/* Remove all ramps; parameters go back to following the registers */
+void sidAutomationClear(sidAutomation_t *a)
+{
+    assert(a);
+    a->numRamps = 0;
+    a->nextChange = SID_NEVER;
+    for (int p = 0; p < SID_PARAM_COUNT; p++)
+        a->value[p] = -1;
+}
+
+/* ------------------------------------------------------------------
+   Add a ramp. Returns false if the ramp table is full or the ramp is
+   invalid (end before start, or an exponential ramp through <= 0).
+   ------------------------------------------------------------------ */
+bool sidAutomationRamp(sidAutomation_t *a,
+                       sidParam_t param,
+                       sidRampShape_t shape,
+                       uint64_t startCycle,
+                       uint64_t endCycle,
+                       double from,
+                       double to)
+{
+    assert(a);
+    if (a->numRamps >= SID_AUTOMATION_MAX_RAMPS || param >= SID_PARAM_COUNT ||
+        endCycle < startCycle)
+        return false;
+    if (shape == SID_RAMP_EXPONENTIAL && (from <= 0.0 || to <= 0.0))
+        return false;
+
+    sidRamp_t *r = &a->ramps[a->numRamps++];
+    r->startCycle = startCycle;
+    r->endCycle = endCycle;
+    r->from = from;
+    r->to = to;
+    r->param = (uint8_t)param;
+    r->shape = (uint8_t)shape;
+
+    sidAutomationUpdate(a);
+    return true;
+}
+
+/* ------------------------------------------------------------------
+   Re-evaluate every parameter at the current cycle and find the next
+   cycle at which any quantised value can change.
+   ------------------------------------------------------------------ */
+void sidAutomationUpdate(sidAutomation_t *a)
+{
+    int active[SID_PARAM_COUNT];
+    uint32_t i;
+    int p;
+
+    for (p = 0; p < SID_PARAM_COUNT; p++)
+        active[p] = -1;
+
+    a->nextChange = SID_NEVER;
+    for (i = 0; i < a->numRamps; i++)
+    {
+        const sidRamp_t *r = &a->ramps[i];
+        if (r->startCycle > a->cycle)
+        {
+            if (r->startCycle < a->nextChange)
+                a->nextChange = r->startCycle;
+        }
+        else if (active[r->param] < 0 ||
+                 r->startCycle >= a->ramps[active[r->param]].startCycle)
+        {
+            active[r->param] = (int)i;
+        }
+    }
+
+    for (p = 0; p < SID_PARAM_COUNT; p++)
+    {
+        if (active[p] < 0)
+            continue;
+        const sidRamp_t *r = &a->ramps[active[p]];
+        a->value[p] = quantise(r, rampValue(r, a->cycle));
+        uint64_t next = rampNextChange(r, a->cycle, a->value[p]);
+        if (next < a->nextChange)
+            a->nextChange = next;
+    }
+}
+
+/* ------------------------------------------------------------------
+   Write the automated values into the chip and mixer settings
+   ------------------------------------------------------------------ */
+void sidAutomationApply(const sidAutomation_t *a, sid_t *sid, sidMix_t *mix)
+{
+    for (int v = 0; v < 3; v++)
+    {
+        if (a->value[SID_PARAM_FREQ0 + v] >= 0)
+            sid->channels[v].frequency = (uint16_t)a->value[SID_PARAM_FREQ0 + v];
+        if (a->value[SID_PARAM_PULSE0 + v] >= 0)
+            sid->channels[v].pulse = (uint16_t)a->value[SID_PARAM_PULSE0 + v];
+    }
+    if (a->value[SID_PARAM_CUTOFF] >= 0)
+        mix->cutoff = sidCutoffFromReg((int8_t)a->value[SID_PARAM_CUTOFF]);
+    if (a->value[SID_PARAM_VOLUME] >= 0)
+        mix->masterVol = (float)a->value[SID_PARAM_VOLUME] / 22.5f;
+}
+
+/* ------------------------------------------------------------------
+   bufferSamplesSid with automation attached
+   ------------------------------------------------------------------ */
+int32_t bufferSamplesSidAutomated(sid_t *sid,
+                                  int cpuCycles,
+                                  const sidRegs_t *regs,
+                                  sidAutomation_t *a,
+                                  void *outSamples,
+                                  int32_t maxSamples,
+                                  int bufferType,
+                                  bool zeroBuffer)
+{
+    sidMix_t mix;
+    sidTaps_t taps;
+    if (cpuCycles <= 0 || maxSamples <= 0)
+        return 0;
+    assert(sid);
+    assert(regs);
+    assert(a);
+
+    sidSetRegs(sid, regs);
+    sidMixFromRegs(regs, &mix);
+    memset(&taps, 0, sizeof(taps));
+    taps.automation = a;
+    return sidRenderTaps(sid, cpuCycles, &mix, outSamples, maxSamples,
+                         bufferType, zeroBuffer, &taps);
+}
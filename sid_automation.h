@@ -0,0 +1,84 @@
+#ifndef SID_AUTOMATION_H
+#define SID_AUTOMATION_H
+
+#include "simple_sid.h"
+
+/* ------------------------------------------------------------------
+   Sample-accurate parameter automation.
+
+   Linear or exponential ramps of frequency, pulse width, cutoff and
+   volume over a range of cycles, on the automation's own cycle clock
+   (cycles rendered with it attached since sidAutomationInit).
+
+   Ramped values are quantised to register resolution. The renderer
+   only re-evaluates them at the sample boundary where the quantised
+   value next changes (precomputed), so a sweep costs one compare per
+   sample. Evaluation points are sample boundaries, which don't depend
+   on how the render is split into calls.
+
+   A parameter follows the latest-starting ramp that has begun, holds
+   that ramp's end value afterwards, and overrides the register value
+   passed to the render call until sidAutomationClear().
+   ------------------------------------------------------------------ */
+#define SID_AUTOMATION_MAX_RAMPS 16
+
+typedef enum
+{
+    SID_PARAM_FREQ0 = 0,
+    SID_PARAM_FREQ1,
+    SID_PARAM_FREQ2,
+    SID_PARAM_PULSE0,
+    SID_PARAM_PULSE1,
+    SID_PARAM_PULSE2,
+    SID_PARAM_CUTOFF,
+    SID_PARAM_VOLUME, /* master volume nibble; filter bits are kept */
+    SID_PARAM_COUNT
+} sidParam_t;
+
+typedef enum
+{
+    SID_RAMP_LINEAR = 0,
+    SID_RAMP_EXPONENTIAL /* from and to must be > 0 */
+} sidRampShape_t;
+
+typedef struct
+{
+    uint64_t startCycle;
+    uint64_t endCycle;
+    double from;
+    double to;
+    uint8_t param; /* sidParam_t */
+    uint8_t shape; /* sidRampShape_t */
+} sidRamp_t;
+
+struct sidAutomation_s
+{
+    sidRamp_t ramps[SID_AUTOMATION_MAX_RAMPS];
+    uint32_t numRamps;
+    uint64_t cycle;                 /* automation clock */
+    uint64_t nextChange;            /* cycle of the next value change */
+    int32_t value[SID_PARAM_COUNT]; /* quantised value, -1 = not automated */
+};
+
+void sidAutomationInit(sidAutomation_t *a);
+void sidAutomationClear(sidAutomation_t *a);
+bool sidAutomationRamp(sidAutomation_t *a,
+                       sidParam_t param,
+                       sidRampShape_t shape,
+                       uint64_t startCycle,
+                       uint64_t endCycle,
+                       double from,
+                       double to);
+void sidAutomationUpdate(sidAutomation_t *a);
+void sidAutomationApply(const sidAutomation_t *a, sid_t *sid, sidMix_t *mix);
+
+int32_t bufferSamplesSidAutomated(sid_t *sid,
+                                  int cpuCycles,
+                                  const sidRegs_t *regs,
+                                  sidAutomation_t *a,
+                                  void *outSamples,
+                                  int32_t maxSamples,
+                                  int bufferType,
+                                  bool zeroBuffer);
+
+#endif
@@ -0,0 +1,515 @@
+/* ------------------------------------------------------------------
+   sid_bench: microbenchmarks for the exported SID kernels.
+
+   Each kernel is run in a tight loop between reads of the hardware
+   performance counters (cycles, instructions, branch misses, L1D read
+   misses) via perf_event_open. If the counters are not available
+   (no permission, VM, non-Linux) the TSC is used for cycles instead
+   and the other columns are left blank.
+
+   Usage: ./sid_bench [iterations]
+   ------------------------------------------------------------------ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "simple_sid.h"
+#include "sid_filter.h"
+#include "sid_segment.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define BENCH_RUNS 5
+#define BENCH_DEFAULT_ITERATIONS 1000000
+#define BENCH_SEGMENT_THREADS 4
+#define BENCH_EVENT_CYCLES 20000 /* about a PAL frame per event */
+
+enum
+{
+    COUNTER_CYCLES = 0,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_L1D_MISSES,
+    COUNTER_COUNT
+};
+
+typedef struct
+{
+    uint64_t value[COUNTER_COUNT];
+    bool valid[COUNTER_COUNT];
+} benchCounters_t;
+
+/* File descriptors for the counter group; -1 when unavailable */
+static int counterFd[COUNTER_COUNT] = {-1, -1, -1, -1};
+static bool usePerf = false;
+
+/* Defeats dead-code elimination of kernel results */
+static volatile float benchSink;
+
+/* ------------------------------------------------------------------
+   Counter access
+   ------------------------------------------------------------------ */
+#ifdef __linux__
+static int openCounter(uint32_t type, uint64_t config, int groupFd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = (groupFd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+#endif
+
+static void openCounters(void)
+{
+#ifdef __linux__
+    counterFd[COUNTER_CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (counterFd[COUNTER_CYCLES] < 0)
+        return;
+    counterFd[COUNTER_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,
+                                                  counterFd[COUNTER_CYCLES]);
+    counterFd[COUNTER_BRANCH_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,
+                                                   counterFd[COUNTER_CYCLES]);
+    counterFd[COUNTER_L1D_MISSES] = openCounter(PERF_TYPE_HW_CACHE,
+                                                PERF_COUNT_HW_CACHE_L1D |
+                                                    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                                                counterFd[COUNTER_CYCLES]);
+    usePerf = true;
+#endif
+}
+
+static void closeCounters(void)
+{
+#ifdef __linux__
+    for (int i = 0; i < COUNTER_COUNT; i++)
+    {
+        if (counterFd[i] >= 0)
+            close(counterFd[i]);
+        counterFd[i] = -1;
+    }
+#endif
+}
+
+static uint64_t readTsc(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void startCounters(benchCounters_t *c)
+{
+    memset(c, 0, sizeof(*c));
+#ifdef __linux__
+    if (usePerf)
+    {
+        ioctl(counterFd[COUNTER_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(counterFd[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return;
+    }
+#endif
+    c->value[COUNTER_CYCLES] = readTsc();
+}
+
+static void stopCounters(benchCounters_t *c)
+{
+#ifdef __linux__
+    if (usePerf)
+    {
+        ioctl(counterFd[COUNTER_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        for (int i = 0; i < COUNTER_COUNT; i++)
+        {
+            uint64_t v;
+            if (counterFd[i] >= 0 && read(counterFd[i], &v, sizeof(v)) == (ssize_t)sizeof(v))
+            {
+                c->value[i] = v;
+                c->valid[i] = true;
+            }
+        }
+        return;
+    }
+#endif
+    c->value[COUNTER_CYCLES] = readTsc() - c->value[COUNTER_CYCLES];
+    c->valid[COUNTER_CYCLES] = true;
+}
+
+/* ------------------------------------------------------------------
+   Kernels. Each runs 'n' calls that correspond to 'n' output samples
+   (~22 SID cycles per sample at 44.1kHz).
+   ------------------------------------------------------------------ */
+#define BENCH_SAMPLE_RATE 44100
+#define BENCH_CYCLES_PER_SAMPLE 22
+
+typedef struct
+{
+    const char *name;
+    uint8_t waveform;      /* channel 0 waveform */
+    uint8_t syncWaveform;  /* channel 1 waveform (sync/ring target) */
+    void (*run)(sid_t *sid, int n, uint8_t arg);
+    uint8_t arg;
+} benchKernel_t;
+
+static void setupChip(sid_t *sid, uint8_t waveform, uint8_t syncWaveform)
+{
+    sidInit(sid, BENCH_SAMPLE_RATE);
+    for (int i = 0; i < 3; i++)
+    {
+        sid->channels[i].frequency = (uint16_t)(7493 + 1000 * i);
+        sid->channels[i].pulse = 0x0800;
+        sid->channels[i].ad = 0x00;
+        sid->channels[i].sr = 0xf0;
+        sid->channels[i].volumeLevel = 0xff;
+        sid->channels[i].state = DECAY;
+    }
+    sid->channels[0].waveform = waveform;
+    sid->channels[1].waveform = syncWaveform;
+}
+
+static void runClock(sid_t *sid, int n, uint8_t arg)
+{
+    (void)arg;
+    sidChannel_t *ch = &sid->channels[0];
+    for (int i = 0; i < n; i++)
+        clockSidChannel(ch, BENCH_CYCLES_PER_SAMPLE);
+    benchSink = (float)ch->accumulator;
+}
+
+static void runClockChip(sid_t *sid, int n, uint8_t arg)
+{
+    (void)arg;
+    for (int i = 0; i < n; i++)
+        sidClockChannels(sid, BENCH_CYCLES_PER_SAMPLE);
+    benchSink = (float)sid->channels[0].accumulator;
+}
+
+static void runTriangle(sid_t *sid, int n, uint8_t arg)
+{
+    (void)arg;
+    sidChannel_t *ch = &sid->channels[0];
+    unsigned acc = 0;
+    for (int i = 0; i < n; i++)
+    {
+        ch->accumulator = (ch->accumulator + ch->frequency * BENCH_CYCLES_PER_SAMPLE) & 0xffffff;
+        acc += triangleSidChannel(ch);
+    }
+    benchSink = (float)acc;
+}
+
+static void runNoise(sid_t *sid, int n, uint8_t arg)
+{
+    (void)arg;
+    sidChannel_t *ch = &sid->channels[0];
+    unsigned acc = 0;
+    for (int i = 0; i < n; i++)
+    {
+        ch->noiseGenerator = ((ch->noiseGenerator << 1) | ((ch->noiseGenerator >> 22) & 1)) & 0x7fffff;
+        acc += noiseSidChannel(ch);
+    }
+    benchSink = (float)acc;
+}
+
+static void runOutput(sid_t *sid, int n, uint8_t arg)
+{
+    sidChannel_t *ch = &sid->channels[0];
+    float acc = 0.f;
+    ch->waveform = arg;
+    for (int i = 0; i < n; i++)
+    {
+        ch->accumulator = (ch->accumulator + ch->frequency * BENCH_CYCLES_PER_SAMPLE) & 0xffffff;
+        acc += getOutputSidChannel(ch);
+    }
+    benchSink = acc;
+}
+
+static void runFilter(sid_t *sid, int n, uint8_t arg)
+{
+    float out = 0.f;
+    float acc = 0.f;
+    for (int i = 0; i < n; i++)
+    {
+        float in = (i & 64) ? 0.5f : -0.5f;
+        sidFilterStep(in, 0.3f, 1.75f, arg, &sid->filter, &out);
+        acc += out;
+    }
+    benchSink = acc;
+}
+
+static void runFilterOs(sid_t *sid, int n, uint8_t arg)
+{
+    static float in[SID_FILTER_BLOCK];
+    static float out[SID_FILTER_BLOCK];
+    sidFilterOs_t f;
+    (void)sid;
+    for (int i = 0; i < SID_FILTER_BLOCK; i++)
+        in[i] = (i & 32) ? 0.5f : -0.5f;
+    sidFilterOsInit(&f, arg);
+    while (n > 0)
+    {
+        int chunk = (n < SID_FILTER_BLOCK) ? n : SID_FILTER_BLOCK;
+        sidFilterOsBlock(&f, in, out, chunk, 0.3f, 1.75f, 0x70);
+        n -= chunk;
+    }
+    benchSink = out[0];
+}
+
+static void runBuffer(sid_t *sid, int n, uint8_t arg)
+{
+    static int16_t out[4096];
+    sidRegs_t regs;
+    memset(&regs, 0, sizeof(regs));
+    regs.freq0 = 7493;
+    regs.pulse0 = 0x0800;
+    regs.waveform0 = 0x41;
+    regs.sr0 = (int8_t)0xf0;
+    regs.freq1 = 3746;
+    regs.waveform1 = 0x11;
+    regs.sr1 = (int8_t)0xf0;
+    regs.freq2 = 20000;
+    regs.waveform2 = (int8_t)0x81;
+    regs.sr2 = (int8_t)0xf0;
+    regs.filterCtrl = (int8_t)arg;
+    regs.volume = 0x1f;
+    regs.cutoff = 0x40;
+    while (n > 0)
+    {
+        int chunk = (n < 4096) ? n : 4096;
+        int got = bufferSamplesSid(sid, chunk * BENCH_CYCLES_PER_SAMPLE * 2, &regs,
+                                   out, chunk, BUFFER_INT16, true);
+        if (got <= 0)
+            break;
+        n -= got;
+    }
+    benchSink = out[0];
+}
+
+static const benchKernel_t kernels[] = {
+    {"clockSidChannel fast", 0x41, 0x00, runClock, 0},
+    {"clockSidChannel noise", 0x81, 0x00, runClock, 0},
+    {"clockSidChannel sync", 0x41, 0x42, runClock, 0},
+    {"sidClockChannels fast", 0x41, 0x00, runClockChip, 0},
+    {"sidClockChannels noise", 0x81, 0x00, runClockChip, 0},
+    {"sidClockChannels sync", 0x41, 0x42, runClockChip, 0},
+    {"triangleSidChannel", 0x11, 0x00, runTriangle, 0},
+    {"triangleSidChannel ring", 0x15, 0x00, runTriangle, 0},
+    {"noiseSidChannel", 0x81, 0x00, runNoise, 0},
+    {"getOutput triangle", 0x10, 0x00, runOutput, 0x10},
+    {"getOutput sawtooth", 0x20, 0x00, runOutput, 0x20},
+    {"getOutput pulse", 0x40, 0x00, runOutput, 0x40},
+    {"getOutput tri+pulse", 0x50, 0x00, runOutput, 0x50},
+    {"getOutput saw+pulse", 0x60, 0x00, runOutput, 0x60},
+    {"getOutput tri+saw+pulse", 0x70, 0x00, runOutput, 0x70},
+    {"getOutput noise", 0x80, 0x00, runOutput, 0x80},
+    {"sidFilterStep LP", 0x00, 0x00, runFilter, 0x10},
+    {"sidFilterStep LP+BP+HP", 0x00, 0x00, runFilter, 0x70},
+    {"sidFilterOsBlock 1x", 0x00, 0x00, runFilterOs, 1},
+    {"sidFilterOsBlock 2x", 0x00, 0x00, runFilterOs, 2},
+    {"sidFilterOsBlock 4x", 0x00, 0x00, runFilterOs, 4},
+    {"bufferSamplesSid direct", 0x00, 0x00, runBuffer, 0x00},
+    {"bufferSamplesSid filtered", 0x00, 0x00, runBuffer, 0x07},
+};
+
+/* ------------------------------------------------------------------
+   Run one kernel BENCH_RUNS times and keep the fastest run
+   ------------------------------------------------------------------ */
+static void benchKernel(const benchKernel_t *k, int iterations)
+{
+    benchCounters_t best;
+    bool haveBest = false;
+    sid_t sid;
+
+    /* warm up caches and branch predictors */
+    setupChip(&sid, k->waveform, k->syncWaveform);
+    k->run(&sid, iterations / 10 + 1, k->arg);
+
+    for (int r = 0; r < BENCH_RUNS; r++)
+    {
+        benchCounters_t c;
+        setupChip(&sid, k->waveform, k->syncWaveform);
+        startCounters(&c);
+        k->run(&sid, iterations, k->arg);
+        stopCounters(&c);
+        if (!haveBest || c.value[COUNTER_CYCLES] < best.value[COUNTER_CYCLES])
+        {
+            best = c;
+            haveBest = true;
+        }
+    }
+
+    double n = (double)iterations;
+    printf("%-28s %10.2f", k->name, best.value[COUNTER_CYCLES] / n);
+    if (best.valid[COUNTER_INSTRUCTIONS])
+        printf(" %10.2f %6.2f", best.value[COUNTER_INSTRUCTIONS] / n,
+               best.value[COUNTER_CYCLES]
+                   ? (double)best.value[COUNTER_INSTRUCTIONS] / best.value[COUNTER_CYCLES]
+                   : 0.0);
+    else
+        printf(" %10s %6s", "-", "-");
+    if (best.valid[COUNTER_BRANCH_MISSES])
+        printf(" %10.4f", best.value[COUNTER_BRANCH_MISSES] / n);
+    else
+        printf(" %10s", "-");
+    if (best.valid[COUNTER_L1D_MISSES])
+        printf(" %10.4f", best.value[COUNTER_L1D_MISSES] / n);
+    else
+        printf(" %10s", "-");
+    printf("\n");
+}
+
+/* ------------------------------------------------------------------
+   Segmented render. The pool's time is wall time, which the per-thread
+   counters above can't give, so this is timed with the monotonic
+   clock: the serial render, the state-only pre-pass alone, and the
+   pooled render. The pre-pass is serial, which bounds the speed-up at
+   serial / (pre-pass + serial / threads) however many cores there are.
+   ------------------------------------------------------------------ */
+static double wallSeconds(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/* An event stream of about n samples: three gated voices, a note per
+   event, the filter routed as 'filterCtrl' says */
+static sidEvent_t *makeStream(int n, uint8_t filterCtrl, int32_t *numEvents)
+{
+    int32_t count = (int32_t)((int64_t)n * BENCH_CYCLES_PER_SAMPLE / BENCH_EVENT_CYCLES + 1);
+    sidEvent_t *events = (sidEvent_t *)malloc((size_t)count * sizeof(sidEvent_t));
+    if (!events)
+        return NULL;
+    for (int32_t i = 0; i < count; i++)
+    {
+        sidRegs_t *r = &events[i].regs;
+        memset(r, 0, sizeof(*r));
+        r->freq0 = (int16_t)(4000 + (i % 12) * 300);
+        r->pulse0 = 0x0800;
+        r->waveform0 = (int8_t)((i % 4 == 3) ? 0x40 : 0x41);
+        r->ad0 = 0x22;
+        r->sr0 = (int8_t)0xa4;
+        r->freq1 = 3746;
+        r->waveform1 = 0x11;
+        r->sr1 = (int8_t)0xf0;
+        r->freq2 = (int16_t)(1000 + (i % 5) * 700);
+        r->waveform2 = 0x21;
+        r->sr2 = (int8_t)0xf0;
+        r->filterCtrl = (int8_t)filterCtrl;
+        r->cutoff = (int8_t)(i * 7);
+        r->volume = 0x1f;
+        events[i].cycles = BENCH_EVENT_CYCLES;
+    }
+    *numEvents = count;
+    return events;
+}
+
+/* Best of BENCH_RUNS: serial, pre-pass only (out NULL) or pooled */
+static double timeStream(sidSegmentPool_t *pool, const sidEvent_t *events, int32_t numEvents,
+                         int16_t *out, int32_t maxSamples)
+{
+    double best = 0.0;
+    for (int r = 0; r < BENCH_RUNS; r++)
+    {
+        sid_t sid;
+        sidInit(&sid, 44100);
+        double start = wallSeconds();
+        if (pool)
+            sidRenderEventsPooled(pool, &sid, events, numEvents, out, maxSamples, BUFFER_INT16);
+        else
+            sidRenderEvents(&sid, events, numEvents, out, maxSamples, BUFFER_INT16);
+        double t = wallSeconds() - start;
+        if (r == 0 || t < best)
+            best = t;
+    }
+    return best;
+}
+
+static void benchSegments(int iterations)
+{
+    static const struct
+    {
+        const char *name;
+        uint8_t filterCtrl;
+    } streams[] = {
+        {"direct", 0x00},
+        {"filtered", 0x07},
+    };
+    sidSegmentPool_t pool;
+    int32_t maxSamples = iterations + iterations / 8;
+    int16_t *out = (int16_t *)malloc((size_t)maxSamples * sizeof(int16_t));
+    if (!out || !sidSegmentPoolInit(&pool, BENCH_SEGMENT_THREADS))
+    {
+        free(out);
+        printf("segmented render: can't start %d threads\n", BENCH_SEGMENT_THREADS);
+        return;
+    }
+
+    long cores = 0;
+#ifdef _SC_NPROCESSORS_ONLN
+    cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    printf("\nsegmented render, %d threads (%ld cores), wall time per sample:\n",
+           BENCH_SEGMENT_THREADS, cores);
+    printf("%-12s %10s %10s %10s %10s %10s\n", "stream", "serial ns", "pre-pass", "pooled ns",
+           "speed-up", "bound");
+    for (size_t s = 0; s < sizeof(streams) / sizeof(streams[0]); s++)
+    {
+        int32_t numEvents;
+        sidEvent_t *events = makeStream(iterations, streams[s].filterCtrl, &numEvents);
+        if (!events)
+            break;
+        double serial = timeStream(NULL, events, numEvents, out, maxSamples);
+        double prePass = timeStream(NULL, events, numEvents, NULL, maxSamples);
+        double pooled = timeStream(&pool, events, numEvents, out, maxSamples);
+        double bound = serial / (prePass + serial / BENCH_SEGMENT_THREADS);
+        double ns = 1e9 / (double)iterations;
+        printf("%-12s %10.2f %10.2f %10.2f %9.2fx %9.2fx\n", streams[s].name, serial * ns,
+               prePass * ns, pooled * ns, serial / pooled, bound);
+        free(events);
+    }
+    sidSegmentPoolDestroy(&pool);
+    free(out);
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+    if (argc > 1)
+        iterations = atoi(argv[1]);
+    if (iterations <= 0)
+    {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    openCounters();
+    printf("counters: %s, %d iterations x %d runs (best run shown)\n",
+           usePerf ? "perf_event_open" : "TSC fallback", iterations, BENCH_RUNS);
+    printf("%-28s %10s %10s %6s %10s %10s\n",
+           "kernel", "cyc/sample", "ins/sample", "IPC", "br-miss", "L1D-miss");
+
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+        benchKernel(&kernels[i], iterations);
+    benchSegments(iterations);
+
+    closeCounters();
+    return 0;
+}
@@ -0,0 +1,340 @@
+#include "sid_cache.h"
+
+/* Bytes of sid_t that hold state (everything before the tail padding) */
+#define SID_STATE_BYTES (offsetof(sid_t, cycleAccumulator) + sizeof(uint64_t))
+
+struct sidCacheEntry_s
+{
+    sid_t start; /* chip state before the render */
+    sid_t end;   /* chip state after it */
+    sidCacheEntry_t *chain;
+    sidCacheEntry_t *lruPrev;
+    sidCacheEntry_t *lruNext;
+    uint64_t hash;
+    sidEvent_t *events; /* copy of the program; PCM follows it */
+    void *pcm;
+    size_t bytes; /* counted against maxBytes */
+    int32_t numEvents;
+    int32_t maxSamples;
+    int32_t numSamples;
+    int bufferType;
+};
+
+static size_t sampleBytes(int bufferType)
+{
+    return (bufferType == BUFFER_INT16) ? sizeof(int16_t) : sizeof(float);
+}
+
+/* More samples than the program can produce from 'sid' (one per whole
+   cycles-per-sample, plus the phase carried in), capped at maxSamples.
+   Scratch PCM is sized by this rather than by the caller's capacity;
+   since the bound is never reached below the cap, rendering with it as
+   the limit runs every event exactly as maxSamples would. */
+static int32_t samplesBound(const sid_t *sid,
+                            const sidEvent_t *events,
+                            int32_t numEvents,
+                            int32_t maxSamples)
+{
+    int64_t cycles = 0;
+    for (int32_t i = 0; i < numEvents; i++)
+        if (events[i].cycles > 0)
+            cycles += events[i].cycles;
+    int64_t perSample = (int64_t)(sid->cyclesPerSample >> SID_PHASE_BITS);
+    if (perSample < 1)
+        perSample = 1;
+    int64_t carried = (int64_t)(sid->cycleAccumulator / sid->cyclesPerSample);
+    int64_t bound = cycles / perSample + carried + 2;
+    return (bound < maxSamples) ? (int32_t)bound : maxSamples;
+}
+
+/* ------------------------------------------------------------------
+   Key hashing (64-bit FNV-1a) and comparison
+   ------------------------------------------------------------------ */
+static uint64_t hashBytes(uint64_t h, const void *data, size_t n)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < n; i++)
+    {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static uint64_t keyHash(const sid_t *sid,
+                        const sidEvent_t *events,
+                        int32_t numEvents,
+                        int32_t maxSamples,
+                        int bufferType)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = hashBytes(h, sid, SID_STATE_BYTES);
+    h = hashBytes(h, &maxSamples, sizeof(maxSamples));
+    h = hashBytes(h, &bufferType, sizeof(bufferType));
+    /* sidRegs_t has padding, so keys are built field by field */
+    for (int32_t i = 0; i < numEvents; i++)
+    {
+        const sidRegs_t *r = &events[i].regs;
+#define HASH_FIELD(f) h = hashBytes(h, &r->f, sizeof(r->f));
+        SID_REG_FIELDS(HASH_FIELD)
+#undef HASH_FIELD
+        h = hashBytes(h, &events[i].cycles, sizeof(events[i].cycles));
+    }
+    return h;
+}
+
+static bool regsEqual(const sidRegs_t *a, const sidRegs_t *b)
+{
+#define FIELD_EQUAL(f) if (a->f != b->f) return false;
+    SID_REG_FIELDS(FIELD_EQUAL)
+#undef FIELD_EQUAL
+    return true;
+}
+
+static bool entryMatches(const sidCacheEntry_t *e,
+                         uint64_t hash,
+                         const sid_t *sid,
+                         const sidEvent_t *events,
+                         int32_t numEvents,
+                         int32_t maxSamples,
+                         int bufferType)
+{
+    if (e->hash != hash || e->numEvents != numEvents ||
+        e->maxSamples != maxSamples || e->bufferType != bufferType)
+        return false;
+    if (memcmp(&e->start, sid, SID_STATE_BYTES) != 0)
+        return false;
+    for (int32_t i = 0; i < numEvents; i++)
+        if (e->events[i].cycles != events[i].cycles ||
+            !regsEqual(&e->events[i].regs, &events[i].regs))
+            return false;
+    return true;
+}
+
+static sidCacheEntry_t *find(const sidCache_t *cache,
+                             uint64_t hash,
+                             const sid_t *sid,
+                             const sidEvent_t *events,
+                             int32_t numEvents,
+                             int32_t maxSamples,
+                             int bufferType)
+{
+    sidCacheEntry_t *e = cache->buckets[hash & (SID_CACHE_BUCKETS - 1)];
+    for (; e; e = e->chain)
+        if (entryMatches(e, hash, sid, events, numEvents, maxSamples, bufferType))
+            return e;
+    return NULL;
+}
+
+/* ------------------------------------------------------------------
+   LRU list
+   ------------------------------------------------------------------ */
+static void lruUnlink(sidCache_t *cache, sidCacheEntry_t *e)
+{
+    if (e->lruPrev)
+        e->lruPrev->lruNext = e->lruNext;
+    else
+        cache->lruHead = e->lruNext;
+    if (e->lruNext)
+        e->lruNext->lruPrev = e->lruPrev;
+    else
+        cache->lruTail = e->lruPrev;
+    e->lruPrev = e->lruNext = NULL;
+}
+
+static void lruPush(sidCache_t *cache, sidCacheEntry_t *e)
+{
+    e->lruPrev = NULL;
+    e->lruNext = cache->lruHead;
+    if (cache->lruHead)
+        cache->lruHead->lruPrev = e;
+    else
+        cache->lruTail = e;
+    cache->lruHead = e;
+}
+
+static void removeEntry(sidCache_t *cache, sidCacheEntry_t *e)
+{
+    sidCacheEntry_t **link = &cache->buckets[e->hash & (SID_CACHE_BUCKETS - 1)];
+    while (*link != e)
+        link = &(*link)->chain;
+    *link = e->chain;
+    lruUnlink(cache, e);
+
+    cache->stats.entries--;
+    cache->stats.bytes -= e->bytes;
+    free(e->events);
+    free(e);
+}
+
+static void insert(sidCache_t *cache,
+                   uint64_t hash,
+                   const sid_t *start,
+                   const sid_t *end,
+                   const sidEvent_t *events,
+                   int32_t numEvents,
+                   const void *pcm,
+                   int32_t numSamples,
+                   int32_t maxSamples,
+                   int bufferType)
+{
+    size_t eventBytes = (size_t)numEvents * sizeof(sidEvent_t);
+    size_t pcmBytes = (size_t)numSamples * sampleBytes(bufferType);
+    size_t bytes = sizeof(sidCacheEntry_t) + eventBytes + pcmBytes;
+
+    if (bytes > cache->maxBytes)
+    {
+        cache->stats.uncacheable++;
+        return;
+    }
+    while (cache->stats.bytes + bytes > cache->maxBytes)
+    {
+        removeEntry(cache, cache->lruTail);
+        cache->stats.evictions++;
+    }
+
+    sidCacheEntry_t *e = (sidCacheEntry_t *)aligned_alloc(SID_ALIGN, sizeof(sidCacheEntry_t));
+    char *data = (char *)malloc(eventBytes + pcmBytes + 1);
+    if (!e || !data)
+    {
+        free(e);
+        free(data);
+        return;
+    }
+
+    memcpy(&e->start, start, sizeof(sid_t));
+    memcpy(&e->end, end, sizeof(sid_t));
+    e->hash = hash;
+    e->events = (sidEvent_t *)data;
+    e->pcm = data + eventBytes;
+    e->bytes = bytes;
+    e->numEvents = numEvents;
+    e->maxSamples = maxSamples;
+    e->numSamples = numSamples;
+    e->bufferType = bufferType;
+    if (eventBytes)
+        memcpy(e->events, events, eventBytes);
+    if (pcmBytes)
+        memcpy(e->pcm, pcm, pcmBytes);
+
+    sidCacheEntry_t **bucket = &cache->buckets[hash & (SID_CACHE_BUCKETS - 1)];
+    e->chain = *bucket;
+    *bucket = e;
+    lruPush(cache, e);
+
+    cache->stats.insertions++;
+    cache->stats.entries++;
+    cache->stats.bytes += bytes;
+}
+
+/* ------------------------------------------------------------------
+   Init/destroy
+   ------------------------------------------------------------------ */
+void sidCacheInit(sidCache_t *cache, size_t maxBytes)
+{
+    assert(cache);
+    memset(cache, 0, sizeof(*cache));
+    cache->maxBytes = maxBytes;
+}
+
+/* Drop every entry; statistics other than entries/bytes are kept */
+void sidCacheClear(sidCache_t *cache)
+{
+    assert(cache);
+    while (cache->lruHead)
+        removeEntry(cache, cache->lruHead);
+}
+
+void sidCacheDestroy(sidCache_t *cache)
+{
+    sidCacheClear(cache);
+}
+
+/* ------------------------------------------------------------------
+   sidRenderEvents through the cache. Output and the chip's end state
+   are the same on a hit as on a miss. outSamples may be NULL.
+   ------------------------------------------------------------------ */
+int32_t sidCacheRender(sidCache_t *cache,
+                       sid_t *sid,
+                       const sidEvent_t *events,
+                       int32_t numEvents,
+                       void *outSamples,
+                       int32_t maxSamples,
+                       int bufferType)
+{
+    assert(cache);
+    assert(sid);
+    assert(events || numEvents == 0);
+
+    uint64_t hash = keyHash(sid, events, numEvents, maxSamples, bufferType);
+    sidCacheEntry_t *e = find(cache, hash, sid, events, numEvents, maxSamples, bufferType);
+    if (e)
+    {
+        cache->stats.hits++;
+        lruUnlink(cache, e);
+        lruPush(cache, e);
+        if (outSamples && e->numSamples > 0)
+            memcpy(outSamples, e->pcm, (size_t)e->numSamples * sampleBytes(bufferType));
+        memcpy(sid, &e->end, sizeof(sid_t));
+        return e->numSamples;
+    }
+
+    cache->stats.misses++;
+    sid_t start;
+    memcpy(&start, sid, sizeof(sid_t));
+
+    /* The PCM is needed for the entry even if the caller doesn't want it */
+    void *pcm = outSamples;
+    int32_t limit = maxSamples;
+    if (!pcm && maxSamples > 0)
+    {
+        limit = samplesBound(sid, events, numEvents, maxSamples);
+        pcm = malloc((size_t)limit * sampleBytes(bufferType));
+        if (!pcm)
+            return sidRenderEvents(sid, events, numEvents, NULL, maxSamples, bufferType);
+    }
+
+    int32_t produced = sidRenderEvents(sid, events, numEvents, pcm, limit, bufferType);
+    insert(cache, hash, &start, sid, events, numEvents, pcm, produced, maxSamples, bufferType);
+
+    if (pcm != outSamples)
+        free(pcm);
+    return produced;
+}
+
+/* ------------------------------------------------------------------
+   Re-render a cached program from a copy of 'sid' and check that the
+   stored PCM and end state are byte-identical. Returns false if the
+   program isn't cached or differs. Doesn't touch LRU order or stats.
+   ------------------------------------------------------------------ */
+bool sidCacheVerify(const sidCache_t *cache,
+                    const sid_t *sid,
+                    const sidEvent_t *events,
+                    int32_t numEvents,
+                    int32_t maxSamples,
+                    int bufferType)
+{
+    assert(cache);
+    assert(sid);
+
+    uint64_t hash = keyHash(sid, events, numEvents, maxSamples, bufferType);
+    const sidCacheEntry_t *e = find(cache, hash, sid, events, numEvents, maxSamples, bufferType);
+    if (!e)
+        return false;
+
+    size_t size = sampleBytes(bufferType);
+    int32_t bound = samplesBound(sid, events, numEvents, maxSamples);
+    void *pcm = malloc((size_t)(bound > 0 ? bound : 1) * size);
+    if (!pcm)
+        return false;
+
+    sid_t fresh;
+    memcpy(&fresh, sid, sizeof(sid_t));
+    int32_t produced = sidRenderEvents(&fresh, events, numEvents, pcm, bound, bufferType);
+
+    bool same = produced == e->numSamples &&
+                memcmp(pcm, e->pcm, (size_t)produced * size) == 0 &&
+                memcmp(&fresh, &e->end, SID_STATE_BYTES) == 0;
+    free(pcm);
+    return same;
+}
@@ -0,0 +1,65 @@
+#ifndef SID_CACHE_H
+#define SID_CACHE_H
+
+#include "simple_sid.h"
+
+/* ------------------------------------------------------------------
+   Render-result cache for repeated register programs (sound effects).
+
+   Entries are keyed by content: the starting chip state, the event
+   program (sidEvent_t array), the output format and maxSamples. A hit
+   copies the stored PCM out and moves the chip to the stored end
+   state, exactly as re-rendering would. Keys are hashed to find a
+   bucket and then compared in full, so a hash collision can't serve
+   the wrong sound.
+
+   Memory is bounded by maxBytes (entry, copied program and PCM);
+   the least recently used entries are evicted to make room. A result
+   that wouldn't fit on its own is rendered but not stored.
+
+   Not thread-safe: one cache per thread, or guard it externally.
+   ------------------------------------------------------------------ */
+#define SID_CACHE_BUCKETS 1024 /* power of two */
+
+typedef struct sidCacheEntry_s sidCacheEntry_t;
+
+typedef struct
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    uint64_t uncacheable; /* results larger than the whole cache */
+    uint32_t entries;
+    size_t bytes;
+} sidCacheStats_t;
+
+typedef struct
+{
+    sidCacheEntry_t *buckets[SID_CACHE_BUCKETS];
+    sidCacheEntry_t *lruHead; /* most recently used */
+    sidCacheEntry_t *lruTail; /* next to evict */
+    size_t maxBytes;
+    sidCacheStats_t stats;
+} sidCache_t;
+
+void sidCacheInit(sidCache_t *cache, size_t maxBytes);
+void sidCacheDestroy(sidCache_t *cache);
+void sidCacheClear(sidCache_t *cache);
+
+int32_t sidCacheRender(sidCache_t *cache,
+                       sid_t *sid,
+                       const sidEvent_t *events,
+                       int32_t numEvents,
+                       void *outSamples,
+                       int32_t maxSamples,
+                       int bufferType);
+
+bool sidCacheVerify(const sidCache_t *cache,
+                    const sid_t *sid,
+                    const sidEvent_t *events,
+                    int32_t numEvents,
+                    int32_t maxSamples,
+                    int bufferType);
+
+#endif
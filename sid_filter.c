@@ -0,0 +1,233 @@
+#include "sid_filter.h"
+
+#define SID_FILTER_MAX_STEPS (SID_FILTER_BLOCK * SID_FILTER_MAX_OVERSAMPLE)
+
+/* ------------------------------------------------------------------
+   The cutoff coefficient acts as 2 sin(pi fc / fs); running the
+   filter K times per sample needs 2 sin(pi fc / (K fs)) per step.
+   ------------------------------------------------------------------ */
+static float oversampleCoef(float cutoff, int oversample)
+{
+    if (oversample == 1)
+        return cutoff;
+    float half = cutoff * 0.5f;
+    if (half > 1.f)
+        half = 1.f;
+    return 2.f * sinf(asinf(half) / (float)oversample);
+}
+
+void sidFilterOsInit(sidFilterOs_t *f, int oversample)
+{
+    assert(f);
+    assert(oversample == 1 || oversample == 2 || oversample == 4);
+    memset(f, 0, sizeof(*f));
+    f->oversample = (uint8_t)oversample;
+}
+
+/* ------------------------------------------------------------------
+   Filter numSamples samples of 'in' into 'out' (which may alias).
+   cutoff and resonance are as from sidCutoffFromReg and
+   sidResonanceFromReg; filterSel selects LP/BP/HP (0x10/0x20/0x40).
+   ------------------------------------------------------------------ */
+void sidFilterOsBlock(sidFilterOs_t *f,
+                      const float *in,
+                      float *out,
+                      int32_t numSamples,
+                      float cutoff,
+                      float resonance,
+                      uint8_t filterSel)
+{
+    float x[SID_FILTER_MAX_STEPS];
+    float coef[SID_FILTER_MAX_STEPS];
+    float cube[SID_FILTER_MAX_STEPS];
+    float damp[SID_FILTER_MAX_STEPS];
+    float low[SID_FILTER_MAX_STEPS];
+    float band[SID_FILTER_MAX_STEPS];
+    float high[SID_FILTER_MAX_STEPS];
+    assert(f);
+    assert(in || numSamples <= 0);
+
+    const int os = f->oversample;
+    const float targetCoef = oversampleCoef(cutoff, os);
+    if (!f->primed)
+    {
+        f->coef = f->coefTarget = targetCoef;
+        f->resonance = f->resonanceTarget = resonance;
+        f->rampSteps = 0;
+        f->primed = true;
+    }
+    else if (targetCoef != f->coefTarget || resonance != f->resonanceTarget)
+    {
+        /* New settings: ramp to them from wherever the last ramp got to */
+        f->coefTarget = targetCoef;
+        f->resonanceTarget = resonance;
+        f->rampSteps = SID_FILTER_RAMP_SAMPLES * os;
+        f->coefStep = (targetCoef - f->coef) / (float)f->rampSteps;
+        f->resonanceStep = (resonance - f->resonance) / (float)f->rampSteps;
+    }
+
+    const float gainLow = (filterSel & 0x10) ? 1.f : 0.f;
+    const float gainBand = (filterSel & 0x20) ? 1.f : 0.f;
+    const float gainHigh = (filterSel & 0x40) ? 1.f : 0.f;
+    const float scale = 1.f / (float)os;
+
+    for (int32_t done = 0; done < numSamples;)
+    {
+        int n = (numSamples - done < SID_FILTER_BLOCK) ? numSamples - done : SID_FILTER_BLOCK;
+        int steps = n * os;
+        int i, j;
+
+        /* 1) Coefficients: the rest of the ramp, if any, then flat.
+              Ramp values count back from the target by the steps left,
+              so they don't depend on where calls and blocks were cut. */
+        int ramp = (f->rampSteps < steps) ? f->rampSteps : steps;
+        for (j = 0; j < ramp; j++)
+        {
+            float left = (float)(f->rampSteps - j - 1);
+            coef[j] = f->coefTarget - f->coefStep * left;
+            damp[j] = f->resonanceTarget - f->resonanceStep * left;
+        }
+        for (; j < steps; j++)
+        {
+            coef[j] = f->coefTarget;
+            damp[j] = f->resonanceTarget;
+        }
+        for (j = 0; j < steps; j++)
+            cube[j] = coef[j] * coef[j] * coef[j] * (1.f / 6.f);
+        f->rampSteps -= ramp;
+        f->coef = f->coefTarget - f->coefStep * (float)f->rampSteps;
+        f->resonance = f->resonanceTarget - f->resonanceStep * (float)f->rampSteps;
+
+        /* 2) Upsample (the voices hold their value between samples) */
+        for (i = 0; i < n; i++)
+            for (j = 0; j < os; j++)
+                x[i * os + j] = in[done + i];
+
+        /* 3) The integrators: the only serial part. saturate(c * v) is
+              expanded to v * (c - c^3/6 * v^2) with c^3/6 from pass 1,
+              which keeps the divide and a multiply off the recursion. */
+        float lo = f->state.low;
+        float bd = f->state.band;
+        for (j = 0; j < steps; j++)
+        {
+            float input = x[j] - damp[j] * bd;
+            lo += bd * (coef[j] - cube[j] * bd * bd);
+            float diff = input - lo;
+            bd += diff * (coef[j] - cube[j] * diff * diff);
+            low[j] = lo;
+            band[j] = bd;
+            high[j] = input - lo - bd;
+        }
+        f->state.low = lo;
+        f->state.band = bd;
+
+        /* 4) Mode mix */
+        for (j = 0; j < steps; j++)
+            high[j] = gainLow * low[j] + gainBand * band[j] + gainHigh * high[j];
+
+        /* 5) Decimate back to the output rate */
+        for (i = 0; i < n; i++)
+        {
+            float sum = 0.f;
+            for (j = 0; j < os; j++)
+                sum += high[i * os + j];
+            out[done + i] = sum * scale;
+        }
+
+        done += n;
+    }
+}
+
+/* ------------------------------------------------------------------
+   bufferSamplesSid with the oversampled filter in place of
+   sidFilterStep. The filter state lives in 'f'; sid->filter is left
+   alone.
+   ------------------------------------------------------------------ */
+int32_t bufferSamplesSidOversampled(sid_t *sid,
+                                    int cpuCycles,
+                                    const sidRegs_t *regs,
+                                    sidFilterOs_t *f,
+                                    void *outSamples,
+                                    int32_t maxSamples,
+                                    int bufferType,
+                                    bool zeroBuffer)
+{
+    float fin[SID_FILTER_BLOCK];
+    float direct[SID_FILTER_BLOCK];
+    sidMix_t mix;
+    int32_t outIndex = 0;
+    if (cpuCycles <= 0 || maxSamples <= 0)
+        return 0;
+    assert(sid);
+    assert(regs);
+    assert(f);
+    assert(bufferType == BUFFER_INT16 || bufferType == BUFFER_FLOAT);
+
+    sidSetRegs(sid, regs);
+    sidMixFromRegs(regs, &mix);
+
+    while (cpuCycles > 0 && outIndex < maxSamples)
+    {
+        /* 1) Clock up to a block of samples, keeping the filter input
+              and the direct mix of each */
+        int n = 0;
+        while (cpuCycles > 0 && n < SID_FILTER_BLOCK && outIndex + n < maxSamples)
+        {
+            uint64_t needed = (sid->cycleAccumulator < sid->cyclesPerSample)
+                                  ? (sid->cyclesPerSample - sid->cycleAccumulator)
+                                  : 0;
+            uint64_t neededCycles = (needed + SID_PHASE_ONE - 1) >> SID_PHASE_BITS;
+            int stepNow = ((uint64_t)cpuCycles < neededCycles) ? cpuCycles : (int)neededCycles;
+
+            sidClockChannels(sid, stepNow);
+            cpuCycles -= stepNow;
+
+            sid->cycleAccumulator += (uint64_t)stepNow << SID_PHASE_BITS;
+            if (sid->cycleAccumulator >= sid->cyclesPerSample)
+            {
+                sid->cycleAccumulator -= sid->cyclesPerSample;
+                fin[n] = 0.f;
+                direct[n] = 0.f;
+                for (int i = 0; i < 3; i++)
+                {
+                    float voice = getOutputSidChannel(&sid->channels[i]);
+                    if (mix.filterCtrl & (1 << i))
+                        fin[n] += voice;
+                    else
+                        direct[n] += voice;
+                }
+                n++;
+            }
+        }
+
+        /* 2) Filter the block */
+        sidFilterOsBlock(f, fin, fin, n, mix.cutoff, mix.resonance, mix.filterSel);
+
+        /* 3) Mix, scale by master vol, clamp, store */
+        for (int i = 0; i < n; i++, outIndex++)
+        {
+            float out = (direct[i] + fin[i]) * mix.masterVol;
+            if (out < -1.f)
+                out = -1.f;
+            if (out > 1.f)
+                out = 1.f;
+
+            if (!outSamples)
+                continue;
+            if (bufferType == BUFFER_INT16)
+            {
+                int16_t v = (int16_t)(out * 32767.f);
+                if (zeroBuffer)
+                    ((int16_t *)outSamples)[outIndex] = v;
+                else
+                    ((int16_t *)outSamples)[outIndex] += v;
+            }
+            else if (zeroBuffer)
+                ((float *)outSamples)[outIndex] = out;
+            else
+                ((float *)outSamples)[outIndex] += out;
+        }
+    }
+
+    return outIndex;
+}
@@ -0,0 +1,61 @@
+#ifndef SID_FILTER_H
+#define SID_FILTER_H
+
+#include "simple_sid.h"
+
+/* ------------------------------------------------------------------
+   Oversampled block filter.
+
+   The state-variable filter of sidFilterStep, run 1x, 2x or 4x per
+   output sample over a block of samples. The per-step cutoff
+   coefficient is rescaled for the oversampling, so the response
+   stays where it was while each step takes a smaller bite. That keeps
+   high cutoffs with strong resonance stable. After a change, cutoff
+   and resonance ramp linearly to the new values over
+   SID_FILTER_RAMP_SAMPLES output samples instead of jumping, so sweeps
+   don't zipper. The ramp carries on across calls and blocks, so its
+   length doesn't depend on how the caller cuts the stream.
+
+   Only the integrator recursion runs step by step. The coefficient
+   ramps, input upsampling, mode mixing and decimation are separate
+   passes over the block that the compiler vectorises (the Makefile
+   builds this file with -O2 -ftree-vectorize). At 1x with steady
+   settings the output matches sidFilterStep to float rounding.
+   ------------------------------------------------------------------ */
+#define SID_FILTER_BLOCK 64 /* samples per inner block */
+#define SID_FILTER_MAX_OVERSAMPLE 4
+#define SID_FILTER_RAMP_SAMPLES 64 /* output samples per coefficient ramp */
+
+typedef struct
+{
+    filterState_t state;
+    float coef;            /* per-step cutoff coefficient after the last step */
+    float resonance;       /* likewise for resonance */
+    float coefTarget;      /* where the current ramp ends */
+    float resonanceTarget;
+    float coefStep;        /* per-step increments of the current ramp */
+    float resonanceStep;
+    int32_t rampSteps;     /* steps left in the ramp, 0 once settled */
+    uint8_t oversample;    /* 1, 2 or 4 */
+    bool primed;           /* false until the first block sets the coefficients */
+} sidFilterOs_t;
+
+void sidFilterOsInit(sidFilterOs_t *f, int oversample);
+void sidFilterOsBlock(sidFilterOs_t *f,
+                      const float *in,
+                      float *out,
+                      int32_t numSamples,
+                      float cutoff,
+                      float resonance,
+                      uint8_t filterSel);
+
+int32_t bufferSamplesSidOversampled(sid_t *sid,
+                                    int cpuCycles,
+                                    const sidRegs_t *regs,
+                                    sidFilterOs_t *f,
+                                    void *outSamples,
+                                    int32_t maxSamples,
+                                    int bufferType,
+                                    bool zeroBuffer);
+
+#endif
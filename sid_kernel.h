@@ -0,0 +1,137 @@
+#ifndef SID_KERNEL_H
+#define SID_KERNEL_H
+
+/* ------------------------------------------------------------------
+   The render loop shared by the C core (sidRenderTaps) and the C++
+   layer (sid::render<>), as static inline functions. Each caller
+   passes the output format and mode as constants, so every (format,
+   mode) pair compiles to its own loop with the store branches folded
+   away; voice routing uses selects rather than branches. Channel
+   clocking and the waveforms (sidClockChannels, getOutputSidChannel)
+   stay out of line in simple_sid.c.
+   ------------------------------------------------------------------ */
+#include "simple_sid.h"
+
+#if defined(__GNUC__)
+#define SID_KERNEL static inline __attribute__((always_inline))
+#else
+#define SID_KERNEL static inline
+#endif
+
+/* Whole cycles until the next sample is due (rounded up), capped at
+   the cycles left */
+SID_KERNEL int sidKernelStep(const sid_t *sid, int cpuCycles)
+{
+    uint64_t needed = (sid->cycleAccumulator < sid->cyclesPerSample)
+                          ? (sid->cyclesPerSample - sid->cycleAccumulator)
+                          : 0;
+    uint64_t neededCycles = (needed + SID_PHASE_ONE - 1) >> SID_PHASE_BITS;
+    return ((uint64_t)cpuCycles < neededCycles) ? cpuCycles : (int)neededCycles;
+}
+
+SID_KERNEL float sidKernelSaturate(float x)
+{
+    return x - (x * x * x) / 6.0f;
+}
+
+/* The body of sidFilterStep; returns the mixed filter output */
+SID_KERNEL float sidKernelFilter(float in, float cutoff, float resonance, uint8_t filterSel,
+                                 filterState_t *st)
+{
+    /* 1) Subtract some of the bandpass signal for resonance feedback. */
+    float input = in - (resonance * st->band);
+
+    /* 2) Integrator #1 => "low" output. */
+    st->low += sidKernelSaturate(cutoff * st->band);
+
+    /* 3) Integrator #2 => "band" output. */
+    st->band += sidKernelSaturate(cutoff * (input - st->low));
+
+    /* 4) The highpass output is what's "left over": input - (low + band). */
+    float high = input - st->low - st->band;
+
+    /* 5) Combine whichever modes are requested (0x10 LP, 0x20 BP, 0x40 HP) */
+    float mix = 0.f;
+    if (filterSel & 0x10)
+        mix += st->low;
+    if (filterSel & 0x20)
+        mix += st->band;
+    if (filterSel & 0x40)
+        mix += high;
+    return mix;
+}
+
+/* Mix, filter, scale and clamp one sample from the chip's current
+   state. Both sums start at +0, so adding a selected 0 to either is
+   the same as skipping the add, bit for bit. */
+SID_KERNEL float sidKernelSample(sid_t *sid, const sidMix_t *mix)
+{
+    float out = 0.f;
+    float fin = 0.f;
+    for (int i = 0; i < 3; i++)
+    {
+        float voice = getOutputSidChannel(&sid->channels[i]);
+        bool routed = (mix->filterCtrl >> i) & 1;
+        fin += routed ? voice : 0.f;
+        out += routed ? 0.f : voice;
+    }
+    out += sidKernelFilter(fin, mix->cutoff, mix->resonance, mix->filterSel, &sid->filter);
+
+    out *= mix->masterVol;
+    if (out < -1.f)
+        out = -1.f;
+    if (out > 1.f)
+        out = 1.f;
+    return out;
+}
+
+/* Store one sample: overwrite (zeroBuffer) or accumulate */
+SID_KERNEL void sidKernelStore(void *outSamples, int32_t index, float out, const int bufferType,
+                               const bool zeroBuffer)
+{
+    if (bufferType == BUFFER_INT16)
+    {
+        int16_t *dst = (int16_t *)outSamples + index;
+        int16_t value = (int16_t)(out * 32767.f);
+        if (zeroBuffer)
+            *dst = value;
+        else
+            *dst += value;
+    }
+    else
+    {
+        float *dst = (float *)outSamples + index;
+        if (zeroBuffer)
+            *dst = out;
+        else
+            *dst += out;
+    }
+}
+
+/* ------------------------------------------------------------------
+   Render up to maxSamples samples into outSamples, as sidRenderMix
+   does without taps. Call with constant bufferType and zeroBuffer.
+   ------------------------------------------------------------------ */
+SID_KERNEL int32_t sidRenderKernel(sid_t *sid, int cpuCycles, const sidMix_t *mix, void *outSamples,
+                                   int32_t maxSamples, const int bufferType, const bool zeroBuffer)
+{
+    /* A local copy, so the settings stay in registers across calls */
+    const sidMix_t m = *mix;
+    int32_t outIndex = 0;
+    while (cpuCycles > 0 && outIndex < maxSamples)
+    {
+        int stepNow = sidKernelStep(sid, cpuCycles);
+        sidClockChannels(sid, stepNow);
+        cpuCycles -= stepNow;
+
+        sid->cycleAccumulator += (uint64_t)stepNow << SID_PHASE_BITS;
+        if (sid->cycleAccumulator >= sid->cyclesPerSample)
+        {
+            sid->cycleAccumulator -= sid->cyclesPerSample;
+            sidKernelStore(outSamples, outIndex++, sidKernelSample(sid, &m), bufferType, zeroBuffer);
+        }
+    }
+    return outIndex;
+}
+
+#endif
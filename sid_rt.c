@@ -0,0 +1,171 @@
+#define _POSIX_C_SOURCE 199309L
+#include <float.h>
+#include <time.h>
+#include "sid_rt.h"
+
+/* ------------------------------------------------------------------
+   Latency histogram helpers
+   ------------------------------------------------------------------ */
+static unsigned histBucket(uint64_t ns)
+{
+    if (ns < SID_RT_HIST_SUB)
+        return (unsigned)ns;
+
+    unsigned msb = 63u - (unsigned)__builtin_clzll(ns);
+    unsigned shift = msb - SID_RT_HIST_SUB_BITS;
+    unsigned bucket = (shift + 1) * SID_RT_HIST_SUB +
+                      (unsigned)((ns >> shift) & (SID_RT_HIST_SUB - 1));
+    return (bucket < SID_RT_HIST_BUCKETS) ? bucket : SID_RT_HIST_BUCKETS - 1;
+}
+
+/* Largest latency that falls into 'bucket' */
+static uint64_t histBucketUpper(unsigned bucket)
+{
+    if (bucket < SID_RT_HIST_SUB)
+        return bucket;
+
+    unsigned shift = bucket / SID_RT_HIST_SUB - 1;
+    uint64_t sub = bucket % SID_RT_HIST_SUB;
+    return ((SID_RT_HIST_SUB + sub + 1) << shift) - 1;
+}
+
+/* Only the render thread writes, so load+store needs no RMW */
+static void histRecord(sidRtHistogram_t *h, uint64_t ns)
+{
+    unsigned b = histBucket(ns);
+    atomic_store_explicit(&h->counts[b],
+                          atomic_load_explicit(&h->counts[b], memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_store_explicit(&h->total,
+                          atomic_load_explicit(&h->total, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    if (ns > atomic_load_explicit(&h->maxNs, memory_order_relaxed))
+        atomic_store_explicit(&h->maxNs, ns, memory_order_relaxed);
+}
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static float flushDenormal(float x)
+{
+    return (fabsf(x) < FLT_MIN) ? 0.f : x;
+}
+
+/* ------------------------------------------------------------------
+   Init: chip, precomputed filter tables, empty histogram
+   ------------------------------------------------------------------ */
+void sidRtInit(sidRt_t *rt, int32_t sampleRate)
+{
+    int i;
+    assert(rt);
+    sidInit(&rt->sid, sampleRate);
+
+    for (i = 0; i < 256; i++)
+        rt->cutoffTable[i] = sidCutoffFromReg((int8_t)i);
+    for (i = 0; i < 16; i++)
+        rt->resonanceTable[i] = sidResonanceFromReg((uint8_t)(i << 4));
+
+    sidRtLatencyReset(rt);
+}
+
+/* ------------------------------------------------------------------
+   Render exactly numSamples samples (replacing the buffer contents).
+   Returns numSamples.
+   ------------------------------------------------------------------ */
+int32_t sidRtRender(sidRt_t *rt,
+                    const sidRegs_t *regs,
+                    void *outSamples,
+                    int32_t numSamples,
+                    int bufferType)
+{
+    assert(rt);
+    assert(regs);
+    assert(bufferType == BUFFER_INT16 || bufferType == BUFFER_FLOAT);
+    if (numSamples <= 0)
+        return 0;
+
+    uint64_t start = nowNs();
+    sid_t *sid = &rt->sid;
+    sidMix_t mix;
+
+    sidSetRegs(sid, regs);
+    mix.masterVol = (float)((regs->volume) & 0x0f) / 22.5f;
+    mix.filterSel = ((uint8_t)regs->volume) & 0x70;
+    mix.filterCtrl = (uint8_t)regs->filterCtrl;
+    mix.cutoff = rt->cutoffTable[(uint8_t)regs->cutoff];
+    mix.resonance = rt->resonanceTable[mix.filterCtrl >> 4];
+
+    /* Enough cycles for every sample; the renderer stops at numSamples */
+    int cyclesPerSample = (int)((sid->cyclesPerSample + SID_PHASE_ONE - 1) >> SID_PHASE_BITS);
+    int32_t maxChunk = INT32_MAX / (cyclesPerSample + 1);
+    int32_t done = 0;
+    size_t sampleSize = (bufferType == BUFFER_INT16) ? sizeof(int16_t) : sizeof(float);
+    while (done < numSamples)
+    {
+        int32_t chunk = numSamples - done;
+        if (chunk > maxChunk)
+            chunk = maxChunk;
+        done += sidRenderMix(sid, chunk * (cyclesPerSample + 1), &mix,
+                             (char *)outSamples + (size_t)done * sampleSize,
+                             chunk, bufferType, true);
+    }
+
+    sid->filter.low = flushDenormal(sid->filter.low);
+    sid->filter.band = flushDenormal(sid->filter.band);
+
+    histRecord(&rt->latency, nowNs() - start);
+    return done;
+}
+
+/* ------------------------------------------------------------------
+   Latency queries. Percentiles are reported as the upper edge of the
+   histogram bucket (within 1/16 of the true value, never below it).
+   ------------------------------------------------------------------ */
+uint64_t sidRtLatencyPercentile(const sidRt_t *rt, double fraction)
+{
+    assert(rt);
+    const sidRtHistogram_t *h = &rt->latency;
+    uint64_t total = atomic_load_explicit(&h->total, memory_order_relaxed);
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)ceil(fraction * (double)total);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < SID_RT_HIST_BUCKETS; b++)
+    {
+        seen += atomic_load_explicit(&h->counts[b], memory_order_relaxed);
+        if (seen >= rank)
+        {
+            uint64_t upper = histBucketUpper(b);
+            uint64_t maxNs = atomic_load_explicit(&h->maxNs, memory_order_relaxed);
+            return (upper < maxNs) ? upper : maxNs;
+        }
+    }
+    return atomic_load_explicit(&h->maxNs, memory_order_relaxed);
+}
+
+void sidRtLatency(const sidRt_t *rt, sidRtLatency_t *out)
+{
+    assert(rt);
+    assert(out);
+    out->blocks = atomic_load_explicit(&rt->latency.total, memory_order_relaxed);
+    out->p50Ns = sidRtLatencyPercentile(rt, 0.50);
+    out->p99Ns = sidRtLatencyPercentile(rt, 0.99);
+    out->p999Ns = sidRtLatencyPercentile(rt, 0.999);
+    out->maxNs = atomic_load_explicit(&rt->latency.maxNs, memory_order_relaxed);
+}
+
+void sidRtLatencyReset(sidRt_t *rt)
+{
+    assert(rt);
+    for (unsigned b = 0; b < SID_RT_HIST_BUCKETS; b++)
+        atomic_store_explicit(&rt->latency.counts[b], 0, memory_order_relaxed);
+    atomic_store_explicit(&rt->latency.total, 0, memory_order_relaxed);
+    atomic_store_explicit(&rt->latency.maxNs, 0, memory_order_relaxed);
+}
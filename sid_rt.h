@@ -0,0 +1,61 @@
+#ifndef SID_RT_H
+#define SID_RT_H
+
+#include <stdatomic.h>
+#include "simple_sid.h"
+
+/* ------------------------------------------------------------------
+   Real-time render mode.
+
+   sidRtRender() always produces exactly the requested number of
+   samples, so its cost is bounded by the block size: the sample step
+   never exceeds ceil(cyclesPerSample) cycles, which bounds the ADSR
+   and noise/sync stepping per sample. Work whose cost depends on the
+   register values (the sinf/powf cutoff curve, the resonance divide)
+   is tabulated once in sidRtInit(), and denormals in the filter state
+   are flushed once per block.
+
+   Every block is timed into a log-linear latency histogram that can
+   be read from another thread while the audio thread is rendering.
+   ------------------------------------------------------------------ */
+
+/* 16 sub-buckets per power of two; covers up to ~2^40 ns */
+#define SID_RT_HIST_SUB_BITS 4
+#define SID_RT_HIST_SUB (1 << SID_RT_HIST_SUB_BITS)
+#define SID_RT_HIST_BUCKETS (SID_RT_HIST_SUB * 38)
+
+typedef struct
+{
+    _Atomic uint32_t counts[SID_RT_HIST_BUCKETS];
+    _Atomic uint64_t total;
+    _Atomic uint64_t maxNs;
+} sidRtHistogram_t;
+
+typedef struct
+{
+    uint64_t blocks;
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t p999Ns;
+    uint64_t maxNs;
+} sidRtLatency_t;
+
+typedef struct
+{
+    sid_t sid;
+    float cutoffTable[256];
+    float resonanceTable[16];
+    sidRtHistogram_t latency;
+} sidRt_t;
+
+void sidRtInit(sidRt_t *rt, int32_t sampleRate);
+int32_t sidRtRender(sidRt_t *rt,
+                    const sidRegs_t *regs,
+                    void *outSamples,
+                    int32_t numSamples,
+                    int bufferType);
+uint64_t sidRtLatencyPercentile(const sidRt_t *rt, double fraction);
+void sidRtLatency(const sidRt_t *rt, sidRtLatency_t *out);
+void sidRtLatencyReset(sidRt_t *rt);
+
+#endif
@@ -0,0 +1,255 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdatomic.h>
+#include "sid_segment.h"
+
+typedef struct
+{
+    sid_t start;         /* chip state at the first event */
+    int32_t firstEvent;
+    int32_t numEvents;
+    int32_t firstSample; /* output offset */
+    int32_t numSamples;
+} sidSegment_t;
+
+typedef struct
+{
+    sidSegment_t *segments;
+    int32_t numSegments;
+    _Atomic int32_t next; /* next segment to claim */
+    const sidEvent_t *events;
+    void *outSamples;
+    int bufferType;
+} sidSegmentJob_t;
+
+static size_t sampleBytes(int bufferType)
+{
+    return (bufferType == BUFFER_INT16) ? sizeof(int16_t) : sizeof(float);
+}
+
+/* Claim and render segments until none are left */
+static void segmentWorker(sidSegmentJob_t *job)
+{
+    int32_t s;
+    while ((s = atomic_fetch_add(&job->next, 1)) < job->numSegments)
+    {
+        sidSegment_t *seg = &job->segments[s];
+        char *dst = (char *)job->outSamples + (size_t)seg->firstSample * sampleBytes(job->bufferType);
+        int32_t got = sidRenderEvents(&seg->start, job->events + seg->firstEvent, seg->numEvents,
+                                      dst, seg->numSamples, job->bufferType);
+        assert(got == seg->numSamples);
+        (void)got;
+    }
+}
+
+/* ------------------------------------------------------------------
+   Worker pool. Each worker waits for the generation to change, runs
+   segmentWorker on the posted job, and reports back through 'busy'.
+   ------------------------------------------------------------------ */
+static void *poolWorker(void *arg)
+{
+    sidSegmentPool_t *pool = (sidSegmentPool_t *)arg;
+    uint64_t seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->stop && pool->generation == seen)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->stop)
+            break;
+        seen = pool->generation;
+        void *job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+
+        segmentWorker((sidSegmentJob_t *)job);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void stopWorkers(sidSegmentPool_t *pool, int started)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int t = 0; t < started; t++)
+        pthread_join(pool->threads[t], NULL);
+}
+
+/* ------------------------------------------------------------------
+   Start numThreads - 1 workers (the rendering thread is the last one).
+   Returns false, with nothing left running, if they can't be started.
+   ------------------------------------------------------------------ */
+bool sidSegmentPoolInit(sidSegmentPool_t *pool, int numThreads)
+{
+    assert(pool);
+    memset(pool, 0, sizeof(*pool));
+    if (numThreads < 1)
+        numThreads = 1;
+    pool->numThreads = numThreads;
+    if (numThreads == 1)
+        return true;
+
+    pool->threads = (pthread_t *)malloc((size_t)(numThreads - 1) * sizeof(pthread_t));
+    if (!pool->threads)
+        return false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for (int t = 0; t < numThreads - 1; t++)
+    {
+        if (pthread_create(&pool->threads[t], NULL, poolWorker, pool) != 0)
+        {
+            stopWorkers(pool, t);
+            pool->numThreads = t + 1; /* so destroy tears down the sync objects */
+            sidSegmentPoolDestroy(pool);
+            return false;
+        }
+    }
+    return true;
+}
+
+void sidSegmentPoolDestroy(sidSegmentPool_t *pool)
+{
+    assert(pool);
+    if (pool->threads)
+    {
+        if (!pool->stop)
+            stopWorkers(pool, pool->numThreads - 1);
+        pthread_cond_destroy(&pool->idle);
+        pthread_cond_destroy(&pool->wake);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->threads);
+    }
+    memset(pool, 0, sizeof(*pool));
+}
+
+/* Run a job on every worker and the calling thread; returns when all are done */
+static void runJob(sidSegmentPool_t *pool, sidSegmentJob_t *job)
+{
+    int workers = pool->numThreads - 1;
+    if (workers > 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->job = job;
+        pool->busy = workers;
+        pool->generation++;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    segmentWorker(job);
+
+    if (workers > 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->busy > 0)
+            pthread_cond_wait(&pool->idle, &pool->lock);
+        pool->job = NULL;
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/* ------------------------------------------------------------------
+   Render 'events' into outSamples on the pool's threads. Returns the
+   number of samples written, as sidRenderEvents would.
+   ------------------------------------------------------------------ */
+int32_t sidRenderEventsPooled(sidSegmentPool_t *pool,
+                              sid_t *sid,
+                              const sidEvent_t *events,
+                              int32_t numEvents,
+                              void *outSamples,
+                              int32_t maxSamples,
+                              int bufferType)
+{
+    assert(pool);
+    assert(sid);
+    assert(outSamples);
+    assert(bufferType == BUFFER_INT16 || bufferType == BUFFER_FLOAT);
+    int numThreads = pool->numThreads;
+    if (numThreads <= 1 || numEvents <= 1)
+        return sidRenderEvents(sid, events, numEvents, outSamples, maxSamples, bufferType);
+
+    /* Aim for equal cycle counts per segment. With a voice routed into
+       the filter, the pre-pass costs about as much as the render. */
+    int64_t totalCycles = 0;
+    for (int32_t i = 0; i < numEvents; i++)
+    {
+        if (events[i].regs.filterCtrl & 0x07)
+            return sidRenderEvents(sid, events, numEvents, outSamples, maxSamples, bufferType);
+        if (events[i].cycles > 0)
+            totalCycles += events[i].cycles;
+    }
+
+    int32_t maxSegments = numThreads * SID_SEGMENTS_PER_THREAD;
+    if (maxSegments > numEvents)
+        maxSegments = numEvents;
+    int64_t cyclesPerSegment = totalCycles / maxSegments + 1;
+
+    sidSegment_t *segments = (sidSegment_t *)aligned_alloc(SID_ALIGN, (size_t)maxSegments * sizeof(sidSegment_t));
+    if (!segments)
+        return sidRenderEvents(sid, events, numEvents, outSamples, maxSamples, bufferType);
+
+    /* 1) State-only pre-pass, snapshotting at segment boundaries */
+    int32_t numSegments = 0;
+    int32_t produced = 0;
+    int64_t segmentCycles = cyclesPerSegment;
+    int32_t i;
+    for (i = 0; i < numEvents && produced < maxSamples; i++)
+    {
+        if (segmentCycles >= cyclesPerSegment && numSegments < maxSegments)
+        {
+            sidSegment_t *seg = &segments[numSegments++];
+            memcpy(&seg->start, sid, sizeof(*sid));
+            seg->firstEvent = i;
+            seg->firstSample = produced;
+            segmentCycles = 0;
+        }
+        produced += bufferSamplesSid(sid, events[i].cycles, &events[i].regs, NULL,
+                                     maxSamples - produced, bufferType, true);
+        if (events[i].cycles > 0)
+            segmentCycles += events[i].cycles;
+    }
+    for (int32_t s = 0; s < numSegments; s++)
+    {
+        int32_t endEvent = (s + 1 < numSegments) ? segments[s + 1].firstEvent : i;
+        int32_t endSample = (s + 1 < numSegments) ? segments[s + 1].firstSample : produced;
+        segments[s].numEvents = endEvent - segments[s].firstEvent;
+        segments[s].numSamples = endSample - segments[s].firstSample;
+    }
+
+    /* 2) Render the segments on the worker pool (this thread included) */
+    sidSegmentJob_t job;
+    job.segments = segments;
+    job.numSegments = numSegments;
+    atomic_init(&job.next, 0);
+    job.events = events;
+    job.outSamples = outSamples;
+    job.bufferType = bufferType;
+    runJob(pool, &job);
+
+    free(segments);
+    return produced;
+}
+
+int32_t sidRenderEventsParallel(sid_t *sid,
+                                const sidEvent_t *events,
+                                int32_t numEvents,
+                                void *outSamples,
+                                int32_t maxSamples,
+                                int bufferType,
+                                int numThreads)
+{
+    sidSegmentPool_t pool;
+    if (numThreads <= 1 || numEvents <= 1 || !sidSegmentPoolInit(&pool, numThreads))
+        return sidRenderEvents(sid, events, numEvents, outSamples, maxSamples, bufferType);
+    int32_t produced = sidRenderEventsPooled(&pool, sid, events, numEvents, outSamples,
+                                             maxSamples, bufferType);
+    sidSegmentPoolDestroy(&pool);
+    return produced;
+}
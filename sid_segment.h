@@ -0,0 +1,73 @@
+#ifndef SID_SEGMENT_H
+#define SID_SEGMENT_H
+
+#include "simple_sid.h"
+
+/* ------------------------------------------------------------------
+   Segmented parallel rendering of one long register-event stream.
+
+   A state-only pre-pass (bufferSamplesSid with no output buffer)
+   runs through the stream once, snapshotting the chip at segment
+   boundaries. The segments are then rendered from those snapshots on
+   a pool of worker threads, each writing its own slice of the output.
+   Segments are cut on event boundaries only, so the result is
+   bit-identical to sidRenderEvents() and 'sid' ends in the same state.
+
+   Limits:
+   - The pre-pass is only cheap while no voice is routed into the
+     filter. The filter state depends on every sample, so the pre-pass
+     would have to clock and filter sample by sample, which costs over
+     90% of the render itself (sid_bench, segmented render; about 5%
+     for an unfiltered stream). A stream that routes a voice into the
+     filter anywhere is rendered serially.
+     Noise and sync don't matter: the pre-pass clocks them exactly in
+     one call either way.
+   - With segments cut on event boundaries, a stream gets at most one
+     segment per event, and a single long event is rendered by one
+     thread however many there are.
+
+   The workers are kept in a sidSegmentPool_t between renders and sleep
+   on a condition variable when idle. The workers point at the pool,
+   so it must stay put between init and destroy. A pool runs one render
+   at a time: share it between callers only with external locking.
+   ------------------------------------------------------------------ */
+#include <pthread.h>
+
+/* Segments per worker thread, for load balancing */
+#define SID_SEGMENTS_PER_THREAD 4
+
+typedef struct
+{
+    pthread_t *threads;
+    int numThreads;        /* render threads, the caller included */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;   /* a job was posted, or stop */
+    pthread_cond_t idle;   /* a worker finished the posted job */
+    void *job;
+    uint64_t generation;   /* bumped once per posted job */
+    int busy;              /* workers still on the posted job */
+    bool stop;
+} sidSegmentPool_t;
+
+bool sidSegmentPoolInit(sidSegmentPool_t *pool, int numThreads);
+void sidSegmentPoolDestroy(sidSegmentPool_t *pool);
+
+int32_t sidRenderEventsPooled(sidSegmentPool_t *pool,
+                              sid_t *sid,
+                              const sidEvent_t *events,
+                              int32_t numEvents,
+                              void *outSamples,
+                              int32_t maxSamples,
+                              int bufferType);
+
+/* One-off render on a temporary pool; it starts and joins numThreads - 1
+   threads per call, so keep a pool for repeated renders */
+int32_t sidRenderEventsParallel(sid_t *sid,
+                                const sidEvent_t *events,
+                                int32_t numEvents,
+                                void *outSamples,
+                                int32_t maxSamples,
+                                int bufferType,
+                                int numThreads);
+
+#endif
@@ -0,0 +1,585 @@
+/* ------------------------------------------------------------------
+   sid_server: render daemon on a UNIX domain socket.
+
+   Keeps a pool of worker threads, each with a pre-initialised chip,
+   so a render costs a connect and a memcpy instead of a process
+   start. One request per connection; all integers are 32-bit in host
+   byte order (the socket is local).
+
+   Request header (6 x uint32):
+     magic       SID_SERVER_MAGIC
+     type        REQUEST_RENDER_LOG, REQUEST_RENDER_PSID or REQUEST_STATS
+     sampleRate  output rate in Hz
+     bufferType  BUFFER_INT16 or BUFFER_FLOAT
+     deadlineMs  time from accept to the end of the render, 0 = none
+     numEvents   number of event rows that follow
+
+   A register log is numEvents rows of SID_EVENT_COLUMNS int32: cycles,
+   then the sidRegs_t fields in declaration order (see sidEventFromRow;
+   the same layout as the Python render_events()). The chip starts
+   from power-on.
+
+   Replies are a stream of chunks, each a 2 x uint32 header (status,
+   payload bytes) and its payload:
+     REPLY_DATA   PCM samples, sent as each chunk is rendered
+     REPLY_END    render finished; payload is the sample count (uint32)
+     REPLY_ERROR  request failed; payload is a message (not terminated)
+
+   PSID files need a 6502 CPU to run the player, which this emulator
+   doesn't have, so PSID requests are answered with REPLY_ERROR.
+
+   REQUEST_STATS replies with one REPLY_DATA chunk of "name value"
+   text lines, then REPLY_END.
+
+   Backpressure: accepted connections wait in a bounded queue, and
+   the server stops accepting while it is full (clients then queue in
+   the listen backlog). Chunks of at most SERVER_CHUNK_SAMPLES samples
+   are written as fast as the client reads them; a worker never
+   renders more than one chunk ahead. A request that passes its
+   deadline, or a client that stalls for longer than
+   SERVER_IO_TIMEOUT_MS, is dropped.
+
+   Usage: ./sid_server socket-path [workers] [queue-length]
+   ------------------------------------------------------------------ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "simple_sid.h"
+
+#define SID_SERVER_MAGIC 0x52444953u /* "SIDR" */
+
+#define REQUEST_RENDER_LOG 1
+#define REQUEST_RENDER_PSID 2
+#define REQUEST_STATS 3
+
+#define REPLY_DATA 0
+#define REPLY_END 1
+#define REPLY_ERROR 2
+
+#define SERVER_CHUNK_SAMPLES 4096
+#define SERVER_MAX_EVENTS (1 << 20)
+#define SERVER_IO_TIMEOUT_MS 5000
+#define SERVER_DEFAULT_WORKERS 4
+#define SERVER_DEFAULT_QUEUE 64
+#define SERVER_STOP_POLL_MS 100 /* how often a full-queue wait checks for a stop */
+
+#define NS_PER_MS 1000000LL
+
+typedef struct
+{
+    int fd;
+    int64_t acceptedNs;
+} job_t;
+
+typedef struct
+{
+    sid_t chip;
+    sid_t pristine; /* power-on state at pristineRate */
+    int32_t pristineRate;
+    int32_t *events;
+    size_t eventCapacity; /* rows */
+    uint8_t chunk[(SERVER_CHUNK_SAMPLES + 1) * sizeof(float)];
+    pthread_t thread;
+} worker_t;
+
+static struct
+{
+    job_t *queue;
+    uint32_t queueLength;
+    uint32_t head;
+    uint32_t count;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    bool stopping;
+    int numWorkers;
+    int64_t startNs;
+} server;
+
+static struct
+{
+    atomic_uint_fast64_t requests;
+    atomic_uint_fast64_t completed;
+    atomic_uint_fast64_t failed;
+    atomic_uint_fast64_t deadlineMisses;
+    atomic_uint_fast64_t unsupported;
+    atomic_uint_fast64_t samples;
+    atomic_uint_fast64_t bytesSent;
+    atomic_uint_fast64_t latencyNsTotal; /* accept to END, completed renders */
+    atomic_uint_fast64_t latencyNsMax;
+    atomic_int active;
+} stats;
+
+static volatile sig_atomic_t stopRequested;
+
+static int64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ------------------------------------------------------------------
+   Socket I/O bounded by a deadline (the request's, or the stall
+   timeout if that comes first). Client sockets are non-blocking.
+   ------------------------------------------------------------------ */
+static int64_t ioDeadline(int64_t requestDeadline)
+{
+    int64_t stall = nowNs() + SERVER_IO_TIMEOUT_MS * NS_PER_MS;
+    return (requestDeadline && requestDeadline < stall) ? requestDeadline : stall;
+}
+
+static bool waitFd(int fd, short events, int64_t deadline)
+{
+    for (;;)
+    {
+        int64_t left = deadline - nowNs();
+        if (left <= 0)
+            return false;
+        struct pollfd p = {.fd = fd, .events = events};
+        int r = poll(&p, 1, (int)((left + NS_PER_MS - 1) / NS_PER_MS));
+        if (r > 0)
+            return true;
+        if (r < 0 && errno != EINTR)
+            return false;
+    }
+}
+
+static bool recvAll(int fd, void *buf, size_t n, int64_t requestDeadline)
+{
+    uint8_t *p = (uint8_t *)buf;
+    int64_t deadline = ioDeadline(requestDeadline);
+    while (n > 0)
+    {
+        ssize_t r = recv(fd, p, n, 0);
+        if (r > 0)
+        {
+            p += r;
+            n -= (size_t)r;
+        }
+        else if (r == 0)
+            return false;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            if (!waitFd(fd, POLLIN, deadline))
+                return false;
+        }
+        else if (errno != EINTR)
+            return false;
+    }
+    return true;
+}
+
+static bool sendAll(int fd, const void *buf, size_t n, int64_t requestDeadline)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    int64_t deadline = ioDeadline(requestDeadline);
+    while (n > 0)
+    {
+        ssize_t r = send(fd, p, n, MSG_NOSIGNAL);
+        if (r >= 0)
+        {
+            p += r;
+            n -= (size_t)r;
+            atomic_fetch_add(&stats.bytesSent, (uint64_t)r);
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            if (!waitFd(fd, POLLOUT, deadline))
+                return false;
+        }
+        else if (errno != EINTR)
+            return false;
+    }
+    return true;
+}
+
+static bool sendReply(int fd, uint32_t status, const void *payload, uint32_t bytes,
+                      int64_t requestDeadline)
+{
+    uint32_t header[2] = {status, bytes};
+    return sendAll(fd, header, sizeof(header), requestDeadline) &&
+           (bytes == 0 || sendAll(fd, payload, bytes, requestDeadline));
+}
+
+static void sendError(int fd, const char *message)
+{
+    /* Best effort, on a fresh stall timeout even if the deadline passed */
+    sendReply(fd, REPLY_ERROR, message, (uint32_t)strlen(message), 0);
+}
+
+/* ------------------------------------------------------------------
+   Requests
+   ------------------------------------------------------------------ */
+static void serveStats(int fd, int64_t deadline)
+{
+    char text[1024];
+    uint32_t queued;
+
+    pthread_mutex_lock(&server.lock);
+    queued = server.count;
+    pthread_mutex_unlock(&server.lock);
+
+    uint64_t completed = atomic_load(&stats.completed);
+    uint64_t latencyTotal = atomic_load(&stats.latencyNsTotal);
+    int n = snprintf(text, sizeof(text),
+                     "uptime_ms %lld\n"
+                     "workers %d\n"
+                     "active %d\n"
+                     "queued %u\n"
+                     "queue_length %u\n"
+                     "requests %llu\n"
+                     "completed %llu\n"
+                     "failed %llu\n"
+                     "deadline_misses %llu\n"
+                     "unsupported %llu\n"
+                     "samples %llu\n"
+                     "bytes_sent %llu\n"
+                     "latency_mean_us %llu\n"
+                     "latency_max_us %llu\n",
+                     (long long)((nowNs() - server.startNs) / NS_PER_MS),
+                     server.numWorkers,
+                     atomic_load(&stats.active),
+                     queued,
+                     server.queueLength,
+                     (unsigned long long)atomic_load(&stats.requests),
+                     (unsigned long long)completed,
+                     (unsigned long long)atomic_load(&stats.failed),
+                     (unsigned long long)atomic_load(&stats.deadlineMisses),
+                     (unsigned long long)atomic_load(&stats.unsupported),
+                     (unsigned long long)atomic_load(&stats.samples),
+                     (unsigned long long)atomic_load(&stats.bytesSent),
+                     (unsigned long long)(completed ? latencyTotal / completed / 1000 : 0),
+                     (unsigned long long)(atomic_load(&stats.latencyNsMax) / 1000));
+    if (sendReply(fd, REPLY_DATA, text, (uint32_t)n, deadline))
+        sendReply(fd, REPLY_END, NULL, 0, deadline);
+}
+
+/* The most cycles that yield no more than 'room' further samples */
+static int32_t sliceCycles(const sid_t *chip, int32_t room)
+{
+    uint64_t limit = (uint64_t)(room + 1) * chip->cyclesPerSample - chip->cycleAccumulator;
+    uint64_t cycles = ((limit + SID_PHASE_ONE - 1) >> SID_PHASE_BITS) - 1;
+    return (cycles > INT32_MAX) ? INT32_MAX : (int32_t)cycles;
+}
+
+/* Render the log in w->events, streaming each chunk as it fills */
+static bool renderLog(worker_t *w, int fd, uint32_t numEvents, int32_t sampleRate,
+                      int bufferType, int64_t deadline)
+{
+    size_t sampleSize = (bufferType == BUFFER_INT16) ? sizeof(int16_t) : sizeof(float);
+    uint32_t total = 0;
+    int32_t filled = 0;
+
+    if (sampleRate != w->pristineRate)
+    {
+        sidInit(&w->pristine, sampleRate);
+        w->pristineRate = sampleRate;
+    }
+    memcpy(&w->chip, &w->pristine, sizeof(sid_t));
+
+    for (uint32_t i = 0; i < numEvents; i++)
+    {
+        const int32_t *row = w->events + (size_t)i * SID_EVENT_COLUMNS;
+        sidRegs_t regs;
+        sidRegsFromRow(&regs, row + 1);
+
+        /* Render in slices that fit the rest of the chunk, so that no
+           chunk exceeds SERVER_CHUNK_SAMPLES and every event keeps its
+           cycles. The render is allowed one sample more than the room
+           so that it doesn't stop before clocking the whole slice; a
+           slice never produces it. */
+        for (int32_t left = row[0]; left > 0;)
+        {
+            int32_t room = SERVER_CHUNK_SAMPLES - filled;
+            int32_t most = sliceCycles(&w->chip, room);
+            int32_t slice = (left < most) ? left : most;
+            filled += bufferSamplesSid(&w->chip, slice, &regs, w->chunk + (size_t)filled * sampleSize,
+                                       room + 1, bufferType, true);
+            left -= slice;
+
+            if (deadline && nowNs() > deadline)
+            {
+                atomic_fetch_add(&stats.deadlineMisses, 1);
+                sendError(fd, "deadline exceeded");
+                return false;
+            }
+            if (filled >= SERVER_CHUNK_SAMPLES)
+            {
+                if (!sendReply(fd, REPLY_DATA, w->chunk, (uint32_t)((size_t)filled * sampleSize), deadline))
+                    return false;
+                total += (uint32_t)filled;
+                filled = 0;
+            }
+        }
+    }
+
+    if (filled > 0 &&
+        !sendReply(fd, REPLY_DATA, w->chunk, (uint32_t)((size_t)filled * sampleSize), deadline))
+        return false;
+    total += (uint32_t)filled;
+    atomic_fetch_add(&stats.samples, total);
+    return sendReply(fd, REPLY_END, &total, sizeof(total), deadline);
+}
+
+static bool serve(worker_t *w, const job_t *job)
+{
+    uint32_t header[6];
+    int fd = job->fd;
+
+    /* The deadline isn't known until the header is in */
+    if (!recvAll(fd, header, sizeof(header), 0) || header[0] != SID_SERVER_MAGIC)
+    {
+        sendError(fd, "bad request header");
+        return false;
+    }
+
+    uint32_t type = header[1];
+    int32_t sampleRate = (int32_t)header[2];
+    int bufferType = (int)header[3];
+    int64_t deadline = header[4] ? job->acceptedNs + (int64_t)header[4] * NS_PER_MS : 0;
+    uint32_t numEvents = header[5];
+
+    switch (type)
+    {
+    case REQUEST_STATS:
+        serveStats(fd, deadline);
+        return true;
+    case REQUEST_RENDER_PSID:
+        atomic_fetch_add(&stats.unsupported, 1);
+        sendError(fd, "PSID rendering needs a 6502 CPU, which this emulator doesn't include; "
+                      "send a register log instead");
+        return false;
+    case REQUEST_RENDER_LOG:
+        break;
+    default:
+        sendError(fd, "unknown request type");
+        return false;
+    }
+
+    if (sampleRate < 1000 || sampleRate > 384000 ||
+        (bufferType != BUFFER_INT16 && bufferType != BUFFER_FLOAT))
+    {
+        sendError(fd, "bad sample rate or buffer type");
+        return false;
+    }
+    if (numEvents > SERVER_MAX_EVENTS)
+    {
+        sendError(fd, "too many events");
+        return false;
+    }
+
+    if (numEvents > w->eventCapacity)
+    {
+        int32_t *events = (int32_t *)realloc(w->events, (size_t)numEvents * SID_EVENT_COLUMNS * sizeof(int32_t));
+        if (!events)
+        {
+            sendError(fd, "out of memory");
+            return false;
+        }
+        w->events = events;
+        w->eventCapacity = numEvents;
+    }
+    if (!recvAll(fd, w->events, (size_t)numEvents * SID_EVENT_COLUMNS * sizeof(int32_t), deadline))
+    {
+        if (deadline && nowNs() > deadline)
+        {
+            atomic_fetch_add(&stats.deadlineMisses, 1);
+            sendError(fd, "deadline exceeded");
+        }
+        return false;
+    }
+
+    if (!renderLog(w, fd, numEvents, sampleRate, bufferType, deadline))
+        return false;
+
+    uint64_t latency = (uint64_t)(nowNs() - job->acceptedNs);
+    uint64_t max = atomic_load(&stats.latencyNsMax);
+    while (latency > max && !atomic_compare_exchange_weak(&stats.latencyNsMax, &max, latency))
+        ;
+    atomic_fetch_add(&stats.latencyNsTotal, latency);
+    return true;
+}
+
+/* ------------------------------------------------------------------
+   Worker pool and accept loop
+   ------------------------------------------------------------------ */
+static void *workerMain(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&server.lock);
+        while (server.count == 0 && !server.stopping)
+            pthread_cond_wait(&server.notEmpty, &server.lock);
+        if (server.count == 0)
+        {
+            pthread_mutex_unlock(&server.lock);
+            return NULL;
+        }
+        job_t job = server.queue[server.head];
+        server.head = (server.head + 1) % server.queueLength;
+        server.count--;
+        pthread_cond_signal(&server.notFull);
+        pthread_mutex_unlock(&server.lock);
+
+        atomic_fetch_add(&stats.active, 1);
+        atomic_fetch_add(&stats.requests, 1);
+        if (serve(w, &job))
+            atomic_fetch_add(&stats.completed, 1);
+        else
+            atomic_fetch_add(&stats.failed, 1);
+        atomic_fetch_sub(&stats.active, 1);
+        close(job.fd);
+    }
+}
+
+static void onSignal(int sig)
+{
+    (void)sig;
+    stopRequested = 1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s socket-path [workers] [queue-length]\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+    int numWorkers = (argc > 2) ? atoi(argv[2]) : SERVER_DEFAULT_WORKERS;
+    int queueLength = (argc > 3) ? atoi(argv[3]) : SERVER_DEFAULT_QUEUE;
+    if (numWorkers < 1 || queueLength < 1)
+    {
+        fprintf(stderr, "workers and queue-length must be positive\n");
+        return 1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "socket path too long\n");
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(path);
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listenFd, queueLength) < 0)
+    {
+        perror("sid_server");
+        return 1;
+    }
+
+    /* No SA_RESTART, so a signal interrupts accept() */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    server.queue = (job_t *)calloc((size_t)queueLength, sizeof(job_t));
+    server.queueLength = (uint32_t)queueLength;
+    server.numWorkers = numWorkers;
+    server.startNs = nowNs();
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.notEmpty, NULL);
+    /* The accept loop waits on notFull with a timeout, since the signal
+       handler can't wake it; on the monotonic clock like nowNs() */
+    pthread_condattr_t monotonic;
+    pthread_condattr_init(&monotonic);
+    pthread_condattr_setclock(&monotonic, CLOCK_MONOTONIC);
+    pthread_cond_init(&server.notFull, &monotonic);
+    pthread_condattr_destroy(&monotonic);
+
+    worker_t *workers = (worker_t *)aligned_alloc(SID_ALIGN, (size_t)numWorkers * sizeof(worker_t));
+    if (!server.queue || !workers)
+    {
+        fprintf(stderr, "sid_server: out of memory\n");
+        return 1;
+    }
+    int started = 0;
+    for (; started < numWorkers; started++)
+    {
+        worker_t *w = &workers[started];
+        sidInit(&w->pristine, 44100);
+        w->pristineRate = 44100;
+        w->events = NULL;
+        w->eventCapacity = 0;
+        int err = pthread_create(&w->thread, NULL, workerMain, w);
+        if (err != 0)
+        {
+            fprintf(stderr, "sid_server: can't start worker %d: %s\n", started, strerror(err));
+            stopRequested = 1;
+            break;
+        }
+    }
+    if (!stopRequested)
+        fprintf(stderr, "sid_server: listening on %s, %d workers\n", path, numWorkers);
+
+    while (!stopRequested)
+    {
+        /* Backpressure: stop accepting while the queue is full */
+        pthread_mutex_lock(&server.lock);
+        while (server.count == server.queueLength && !stopRequested)
+        {
+            struct timespec until;
+            clock_gettime(CLOCK_MONOTONIC, &until);
+            until.tv_nsec += SERVER_STOP_POLL_MS * NS_PER_MS;
+            if (until.tv_nsec >= 1000 * NS_PER_MS)
+            {
+                until.tv_sec++;
+                until.tv_nsec -= 1000 * NS_PER_MS;
+            }
+            pthread_cond_timedwait(&server.notFull, &server.lock, &until);
+        }
+        pthread_mutex_unlock(&server.lock);
+        if (stopRequested)
+            break;
+
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+                perror("sid_server: accept");
+            continue;
+        }
+
+        pthread_mutex_lock(&server.lock);
+        server.queue[(server.head + server.count) % server.queueLength] =
+            (job_t){.fd = fd, .acceptedNs = nowNs()};
+        server.count++;
+        pthread_cond_signal(&server.notEmpty);
+        pthread_mutex_unlock(&server.lock);
+    }
+
+    /* Finish the queued requests, then exit */
+    pthread_mutex_lock(&server.lock);
+    server.stopping = true;
+    pthread_cond_broadcast(&server.notEmpty);
+    pthread_mutex_unlock(&server.lock);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        free(workers[i].events);
+    }
+
+    close(listenFd);
+    unlink(path);
+    free(workers);
+    free(server.queue);
+    return (started == numWorkers) ? 0 : 1;
+}
@@ -0,0 +1,520 @@
+/* ------------------------------------------------------------------
+   sid_server_test: scripted client for sid_server (make check).
+
+   Starts the server with one worker and a queue of one, then checks
+   over the socket:
+     protocol      stats; register logs rendered as int16 and float
+                   match sidRenderEvents() byte for byte, with the
+                   END count and chunks of at most SERVER_CHUNK_SAMPLES;
+                   error replies for bad requests
+     deadline      a long render with a 1 ms deadline is answered with
+                   "deadline exceeded" and counted in the stats
+     backpressure  with the worker held by a stalled client and the
+                   queue full, the server stops accepting, so
+                   non-blocking connects fail once the listen backlog
+                   fills; every admitted client is then served
+
+   Usage: ./sid_server_test ./sid_server
+   ------------------------------------------------------------------ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "simple_sid.h"
+
+/* Protocol, as in sid_server.c */
+#define SID_SERVER_MAGIC 0x52444953u
+#define REQUEST_RENDER_LOG 1
+#define REQUEST_RENDER_PSID 2
+#define REQUEST_STATS 3
+#define REPLY_DATA 0
+#define REPLY_END 1
+#define REPLY_ERROR 2
+#define SERVER_CHUNK_SAMPLES 4096
+#define SERVER_MAX_EVENTS (1 << 20)
+
+#define TEST_SAMPLE_RATE 44100
+#define TEST_REPLY_TIMEOUT_S 10
+#define TEST_CONNECT_TRIES 16 /* non-blocking connects before the backlog must be full */
+
+typedef struct
+{
+    uint8_t *data; /* concatenated REPLY_DATA payloads */
+    size_t bytes;
+    uint32_t status; /* of the last chunk; REPLY_DATA if the stream broke off */
+    uint32_t endCount;
+    uint32_t maxChunk; /* largest REPLY_DATA payload */
+    int chunks;
+    char message[256];
+} reply_t;
+
+static void sleepMs(int ms)
+{
+    struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+        ;
+}
+
+/* ------------------------------------------------------------------
+   Client side
+   ------------------------------------------------------------------ */
+static int connectServer(const char *path, bool nonBlocking)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | (nonBlocking ? SOCK_NONBLOCK : 0), 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    if (nonBlocking)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    struct timeval timeout = {.tv_sec = TEST_REPLY_TIMEOUT_S};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static bool sendBytes(int fd, const void *buf, size_t n)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    while (n > 0)
+    {
+        ssize_t r = send(fd, p, n, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return false;
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+static bool recvBytes(int fd, void *buf, size_t n)
+{
+    uint8_t *p = (uint8_t *)buf;
+    while (n > 0)
+    {
+        ssize_t r = recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return false;
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+/* Header, then the rows (if any); the rows may be cut short by the server */
+static void sendRequest(int fd, uint32_t magic, uint32_t type, uint32_t sampleRate, uint32_t bufferType,
+                        uint32_t deadlineMs, uint32_t numEvents, const int32_t *rows)
+{
+    uint32_t header[6] = {magic, type, sampleRate, bufferType, deadlineMs, numEvents};
+    if (sendBytes(fd, header, sizeof(header)) && rows)
+        sendBytes(fd, rows, (size_t)numEvents * SID_EVENT_COLUMNS * sizeof(int32_t));
+}
+
+/* Read chunks up to REPLY_END or REPLY_ERROR */
+static void readReply(int fd, reply_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->status = REPLY_DATA;
+    for (;;)
+    {
+        uint32_t header[2];
+        if (!recvBytes(fd, header, sizeof(header)))
+            return;
+        uint8_t *payload = (uint8_t *)malloc(header[1] + 1);
+        if (!payload || !recvBytes(fd, payload, header[1]))
+        {
+            free(payload);
+            return;
+        }
+        r->status = header[0];
+        if (header[0] == REPLY_DATA)
+        {
+            uint8_t *data = (uint8_t *)realloc(r->data, r->bytes + header[1] + 1);
+            if (!data)
+            {
+                free(payload);
+                return;
+            }
+            r->data = data;
+            memcpy(r->data + r->bytes, payload, header[1]);
+            r->bytes += header[1];
+            r->data[r->bytes] = 0; /* stats text */
+            if (header[1] > r->maxChunk)
+                r->maxChunk = header[1];
+            r->chunks++;
+        }
+        else if (header[0] == REPLY_END && header[1] == sizeof(uint32_t))
+        {
+            memcpy(&r->endCount, payload, sizeof(uint32_t));
+        }
+        else if (header[0] == REPLY_ERROR)
+        {
+            size_t n = (header[1] < sizeof(r->message)) ? header[1] : sizeof(r->message) - 1;
+            memcpy(r->message, payload, n);
+            r->message[n] = 0;
+        }
+        free(payload);
+        if (header[0] != REPLY_DATA)
+            return;
+    }
+}
+
+/* One request on a fresh connection */
+static void request(const char *path, uint32_t magic, uint32_t type, uint32_t bufferType,
+                    uint32_t deadlineMs, uint32_t numEvents, const int32_t *rows, reply_t *r)
+{
+    int fd = connectServer(path, false);
+    if (fd < 0)
+    {
+        memset(r, 0, sizeof(*r));
+        r->status = REPLY_DATA;
+        return;
+    }
+    sendRequest(fd, magic, type, TEST_SAMPLE_RATE, bufferType, deadlineMs, numEvents, rows);
+    readReply(fd, r);
+    close(fd);
+}
+
+/* The value of one "name value" line of a stats reply, or -1 */
+static long long statsValue(const char *path, const char *name)
+{
+    reply_t r;
+    long long value = -1;
+    request(path, SID_SERVER_MAGIC, REQUEST_STATS, 0, 0, 0, NULL, &r);
+    size_t len = strlen(name);
+    for (const char *line = (const char *)r.data; r.status == REPLY_END && line && *line;)
+    {
+        if (strncmp(line, name, len) == 0 && line[len] == ' ')
+        {
+            value = atoll(line + len + 1);
+            break;
+        }
+        line = strchr(line, '\n');
+        if (line)
+            line++;
+    }
+    free(r.data);
+    return value;
+}
+
+/* ------------------------------------------------------------------
+   Register logs and the reference render
+   ------------------------------------------------------------------ */
+static uint32_t lcg(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+/* 'numEvents' rows of cycles in [minCycles, minCycles + spread) and
+   gated voices with varying registers */
+static int32_t *makeLog(uint32_t numEvents, int32_t minCycles, int32_t spread, uint32_t seed)
+{
+    static const int32_t waveforms[] = {0x11, 0x21, 0x41, 0x81, 0x15, 0x23, 0x40, 0x20};
+    int32_t *rows = (int32_t *)calloc((size_t)numEvents * SID_EVENT_COLUMNS, sizeof(int32_t));
+    if (!rows)
+        return NULL;
+    for (uint32_t i = 0; i < numEvents; i++)
+    {
+        int32_t *row = rows + (size_t)i * SID_EVENT_COLUMNS;
+        row[0] = minCycles + (int32_t)(lcg(&seed) % (uint32_t)spread);
+        for (int v = 0; v < 3; v++)
+        {
+            row[1 + v * 5] = (int32_t)(lcg(&seed) & 0xffff) - 0x8000; /* freq */
+            row[2 + v * 5] = (int32_t)(lcg(&seed) & 0x0fff);          /* pulse */
+            row[3 + v * 5] = waveforms[lcg(&seed) % 8];
+            row[4 + v * 5] = (int32_t)(lcg(&seed) & 0xff) - 0x80; /* ad */
+            row[5 + v * 5] = (int32_t)(lcg(&seed) & 0xff) - 0x80; /* sr */
+        }
+        row[16] = (int32_t)(lcg(&seed) & 0xff) - 0x80; /* cutoff */
+        row[17] = (int32_t)(lcg(&seed) & 0xf7) - 0x80; /* filterCtrl */
+        row[18] = 0x10 | (int32_t)(lcg(&seed) & 0x0f); /* low-pass, volume */
+    }
+    return rows;
+}
+
+static int32_t renderReference(const int32_t *rows, uint32_t numEvents, int bufferType, void *out,
+                               int32_t maxSamples)
+{
+    sid_t sid;
+    sidEvent_t *events = (sidEvent_t *)calloc(numEvents, sizeof(sidEvent_t));
+    if (!events)
+        return -1;
+    for (uint32_t i = 0; i < numEvents; i++)
+    {
+        events[i].cycles = rows[(size_t)i * SID_EVENT_COLUMNS];
+        sidRegsFromRow(&events[i].regs, rows + (size_t)i * SID_EVENT_COLUMNS + 1);
+    }
+    sidInit(&sid, TEST_SAMPLE_RATE);
+    int32_t n = sidRenderEvents(&sid, events, (int32_t)numEvents, out, maxSamples, bufferType);
+    free(events);
+    return n;
+}
+
+/* A rendered reply against the reference; returns false on a mismatch */
+static bool replyMatches(const reply_t *r, const int32_t *rows, uint32_t numEvents, int bufferType,
+                         const char *what)
+{
+    size_t sampleSize = (bufferType == BUFFER_INT16) ? sizeof(int16_t) : sizeof(float);
+    int32_t maxSamples = 1 << 22;
+    void *expected = malloc((size_t)maxSamples * sampleSize);
+    int32_t n = expected ? renderReference(rows, numEvents, bufferType, expected, maxSamples) : -1;
+    bool ok = n >= 0 && r->status == REPLY_END && r->endCount == (uint32_t)n &&
+              r->bytes == (size_t)n * sampleSize && memcmp(r->data, expected, r->bytes) == 0 &&
+              r->maxChunk <= SERVER_CHUNK_SAMPLES * sampleSize;
+    if (!ok)
+        printf("server protocol: %s: status %u, %u samples (reference %d), %zu bytes, "
+               "largest chunk %u bytes\n",
+               what, r->status, r->endCount, n, r->bytes, r->maxChunk);
+    free(expected);
+    return ok;
+}
+
+/* ------------------------------------------------------------------
+   Checks
+   ------------------------------------------------------------------ */
+static int checkProtocol(const char *path)
+{
+    static const struct
+    {
+        uint32_t magic, type, bufferType, numEvents;
+        const char *message;
+    } bad[] = {
+        {0x12345678u, REQUEST_RENDER_LOG, BUFFER_INT16, 1, "bad request header"},
+        {SID_SERVER_MAGIC, REQUEST_RENDER_PSID, BUFFER_INT16, 1, "PSID rendering"},
+        {SID_SERVER_MAGIC, 99, BUFFER_INT16, 1, "unknown request type"},
+        {SID_SERVER_MAGIC, REQUEST_RENDER_LOG, 7, 1, "bad sample rate or buffer type"},
+        {SID_SERVER_MAGIC, REQUEST_RENDER_LOG, BUFFER_INT16, SERVER_MAX_EVENTS + 1, "too many events"},
+    };
+    int failures = 0;
+    reply_t r;
+
+    request(path, SID_SERVER_MAGIC, REQUEST_STATS, 0, 0, 0, NULL, &r);
+    if (r.status != REPLY_END || r.chunks != 1 || !strstr((const char *)r.data, "workers 1\n") ||
+        !strstr((const char *)r.data, "queue_length 1\n"))
+    {
+        printf("server protocol: stats reply status %u, %d chunks\n", r.status, r.chunks);
+        failures++;
+    }
+    free(r.data);
+
+    /* Events up to several chunks long, so slices have to be cut to fit */
+    int32_t *rows = makeLog(60, 1000, 300000, 1);
+    if (!rows)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    request(path, SID_SERVER_MAGIC, REQUEST_RENDER_LOG, BUFFER_INT16, 0, 60, rows, &r);
+    failures += !replyMatches(&r, rows, 60, BUFFER_INT16, "int16 log");
+    free(r.data);
+    request(path, SID_SERVER_MAGIC, REQUEST_RENDER_LOG, BUFFER_FLOAT, 0, 60, rows, &r);
+    failures += !replyMatches(&r, rows, 60, BUFFER_FLOAT, "float log");
+    free(r.data);
+    request(path, SID_SERVER_MAGIC, REQUEST_RENDER_LOG, BUFFER_INT16, 0, 0, NULL, &r);
+    if (r.status != REPLY_END || r.endCount != 0 || r.bytes != 0)
+    {
+        printf("server protocol: empty log: status %u, %u samples\n", r.status, r.endCount);
+        failures++;
+    }
+    free(r.data);
+
+    for (int i = 0; i < (int)(sizeof(bad) / sizeof(bad[0])); i++)
+    {
+        request(path, bad[i].magic, bad[i].type, bad[i].bufferType, 0, bad[i].numEvents, NULL, &r);
+        if (r.status != REPLY_ERROR || strncmp(r.message, bad[i].message, strlen(bad[i].message)) != 0)
+        {
+            printf("server protocol: expected \"%s\", got status %u \"%s\"\n", bad[i].message, r.status,
+                   r.message);
+            failures++;
+        }
+        free(r.data);
+    }
+
+    free(rows);
+    printf("server protocol: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
+static int checkDeadline(const char *path)
+{
+    int failures = 0;
+    reply_t r;
+
+    /* Tens of seconds of audio; far more than a millisecond of work */
+    int32_t *rows = makeLog(400, 100000, 1000, 2);
+    if (!rows)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    long long missesBefore = statsValue(path, "deadline_misses");
+    request(path, SID_SERVER_MAGIC, REQUEST_RENDER_LOG, BUFFER_INT16, 1, 400, rows, &r);
+    if (r.status != REPLY_ERROR || strcmp(r.message, "deadline exceeded") != 0)
+    {
+        printf("server deadline: status %u \"%s\" after %zu bytes\n", r.status, r.message, r.bytes);
+        failures++;
+    }
+    free(r.data);
+    if (statsValue(path, "deadline_misses") != missesBefore + 1)
+    {
+        printf("server deadline: miss not counted\n");
+        failures++;
+    }
+
+    /* The worker is fine afterwards */
+    request(path, SID_SERVER_MAGIC, REQUEST_RENDER_LOG, BUFFER_INT16, 0, 5, rows, &r);
+    failures += !replyMatches(&r, rows, 5, BUFFER_INT16, "log after a deadline miss");
+    free(r.data);
+
+    free(rows);
+    printf("server deadline: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
+static int checkBackpressure(const char *path)
+{
+    int waiting[TEST_CONNECT_TRIES];
+    int numWaiting = 0;
+    bool refused = false;
+    int failures = 0;
+    reply_t r;
+
+    int32_t *rows = makeLog(4, 20000, 5000, 3);
+    if (!rows)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+
+    /* Hold the only worker: a header promising a row that isn't sent yet */
+    int stalled = connectServer(path, false);
+    if (stalled < 0)
+    {
+        printf("server backpressure: can't connect\n");
+        free(rows);
+        return 1;
+    }
+    sendRequest(stalled, SID_SERVER_MAGIC, REQUEST_RENDER_LOG, TEST_SAMPLE_RATE, BUFFER_INT16, 0, 1, NULL);
+    sleepMs(100);
+
+    /* Fill the queue, then the listen backlog, until connects fail */
+    for (int i = 0; i < TEST_CONNECT_TRIES; i++)
+    {
+        int fd = connectServer(path, true);
+        if (fd < 0)
+        {
+            refused = (errno == EAGAIN || errno == EWOULDBLOCK);
+            if (!refused)
+                perror("sid_server_test: connect");
+            break;
+        }
+        sendRequest(fd, SID_SERVER_MAGIC, REQUEST_RENDER_LOG, TEST_SAMPLE_RATE, BUFFER_INT16, 0, 4, rows);
+        waiting[numWaiting++] = fd;
+        sleepMs(20);
+    }
+    if (!refused || numWaiting < 2)
+    {
+        printf("server backpressure: %d connects admitted, %s\n", numWaiting,
+               refused ? "then refused" : "none refused");
+        failures++;
+    }
+
+    /* Release the worker; everyone admitted is served in turn */
+    sendBytes(stalled, rows, SID_EVENT_COLUMNS * sizeof(int32_t));
+    readReply(stalled, &r);
+    failures += !replyMatches(&r, rows, 1, BUFFER_INT16, "stalled client");
+    free(r.data);
+    close(stalled);
+    for (int i = 0; i < numWaiting; i++)
+    {
+        readReply(waiting[i], &r);
+        failures += !replyMatches(&r, rows, 4, BUFFER_INT16, "queued client");
+        free(r.data);
+        close(waiting[i]);
+    }
+
+    free(rows);
+    printf("server backpressure: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char path[64];
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s path-to-sid_server\n", argv[0]);
+        return 1;
+    }
+    snprintf(path, sizeof(path), "/tmp/sid_server_test.%d.sock", (int)getpid());
+
+    pid_t server = fork();
+    if (server < 0)
+    {
+        perror("sid_server_test: fork");
+        return 1;
+    }
+    if (server == 0)
+    {
+        /* One worker and a queue of one, quietly */
+        freopen("/dev/null", "w", stderr);
+        execl(argv[1], argv[1], path, "1", "1", (char *)NULL);
+        _exit(127);
+    }
+
+    /* Wait for it to listen */
+    int fd = -1;
+    for (int i = 0; i < 500 && fd < 0; i++)
+    {
+        fd = connectServer(path, false);
+        if (fd < 0)
+            sleepMs(10);
+    }
+    int failures = 0;
+    if (fd < 0)
+    {
+        printf("server: %s didn't start listening on %s\n", argv[1], path);
+        failures++;
+    }
+    else
+    {
+        /* The probe connection doubles as a stats request */
+        reply_t r;
+        sendRequest(fd, SID_SERVER_MAGIC, REQUEST_STATS, 0, 0, 0, 0, NULL);
+        readReply(fd, &r);
+        free(r.data);
+        close(fd);
+
+        failures += checkProtocol(path);
+        failures += checkDeadline(path);
+        failures += checkBackpressure(path);
+    }
+
+    int status;
+    kill(server, SIGTERM);
+    if (waitpid(server, &status, 0) != server || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        printf("server: didn't shut down cleanly\n");
+        failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#include "sid_stems.h"
+
+/* ------------------------------------------------------------------
+   Init. Set the buffer pointers after this; all start out NULL.
+   ------------------------------------------------------------------ */
+void sidStemsInit(sidStems_t *stems, uint32_t length)
+{
+    assert(stems);
+    memset(stems, 0, sizeof(*stems));
+    stems->length = length;
+}
+
+/* ------------------------------------------------------------------
+   Called by the renderer once per output sample with the raw voice
+   outputs, the shared filter output (both before master volume) and
+   the final clamped mix.
+   ------------------------------------------------------------------ */
+void sidStemsSample(sidStems_t *stems,
+                    const sidMix_t *mix,
+                    const float voice[3],
+                    float filtered,
+                    float out)
+{
+    uint32_t i = stems->position;
+    if (i >= stems->length)
+        return;
+    stems->position++;
+
+    for (int v = 0; v < 3; v++)
+    {
+        if (stems->voicePre[v])
+            stems->voicePre[v][i] = voice[v] * mix->masterVol;
+        if (stems->voicePost[v])
+        {
+            float post = voice[v];
+            if (mix->filterCtrl & (1 << v))
+                sidFilterStep(voice[v], mix->cutoff, mix->resonance, mix->filterSel,
+                              &stems->voiceFilter[v], &post);
+            stems->voicePost[v][i] = post * mix->masterVol;
+        }
+    }
+    if (stems->filter)
+        stems->filter[i] = filtered * mix->masterVol;
+    if (stems->mix)
+        stems->mix[i] = out;
+}
+
+/* ------------------------------------------------------------------
+   bufferSamplesSid with stems attached. outSamples may be NULL to
+   produce the stems only. maxSamples is limited to the room left in
+   the stem buffers.
+   ------------------------------------------------------------------ */
+int32_t bufferSamplesSidStems(sid_t *sid,
+                              int cpuCycles,
+                              const sidRegs_t *regs,
+                              void *outSamples,
+                              int32_t maxSamples,
+                              int bufferType,
+                              bool zeroBuffer,
+                              sidStems_t *stems)
+{
+    sidMix_t mix;
+    sidTaps_t taps;
+    assert(stems);
+    if ((int64_t)maxSamples > (int64_t)(stems->length - stems->position))
+        maxSamples = (int32_t)(stems->length - stems->position);
+    if (cpuCycles <= 0 || maxSamples <= 0)
+        return 0;
+    assert(sid);
+    assert(regs);
+
+    sidSetRegs(sid, regs);
+    sidMixFromRegs(regs, &mix);
+    memset(&taps, 0, sizeof(taps));
+    taps.stems = stems;
+    return sidRenderTaps(sid, cpuCycles, &mix, outSamples, maxSamples,
+                         bufferType, zeroBuffer, &taps);
+}
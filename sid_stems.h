@@ -0,0 +1,53 @@
+#ifndef SID_STEMS_H
+#define SID_STEMS_H
+
+#include "simple_sid.h"
+
+/* ------------------------------------------------------------------
+   Per-voice stem outputs, written by the renderer in the same pass
+   as the normal mix.
+
+   Each stem is a planar float buffer (one value per output sample,
+   scaled by master volume, not clamped except for 'mix'):
+
+     voicePre[v]   voice v straight from the oscillator/envelope
+     voicePost[v]  voice v through its own copy of the filter when it
+                   is routed to the filter, otherwise as voicePre[v]
+     filter        output of the shared filter (all routed voices)
+     mix           the final clamped mix, as written to outSamples
+
+   The filter is nonlinear, so the voicePost stems don't sum to the
+   shared filter output exactly; each runs an isolated filter state
+   kept here, so a voice's post-filter stem depends only on that voice.
+
+   Any buffer may be NULL to skip it. Samples are written at
+   'position', which advances by one per sample up to 'length'.
+   ------------------------------------------------------------------ */
+struct sidStems_s
+{
+    float *voicePre[3];
+    float *voicePost[3];
+    float *filter;
+    float *mix;
+    uint32_t length;   /* capacity of every non-NULL buffer, in samples */
+    uint32_t position; /* next sample written */
+    filterState_t voiceFilter[3];
+};
+
+void sidStemsInit(sidStems_t *stems, uint32_t length);
+void sidStemsSample(sidStems_t *stems,
+                    const sidMix_t *mix,
+                    const float voice[3],
+                    float filtered,
+                    float out);
+
+int32_t bufferSamplesSidStems(sid_t *sid,
+                              int cpuCycles,
+                              const sidRegs_t *regs,
+                              void *outSamples,
+                              int32_t maxSamples,
+                              int bufferType,
+                              bool zeroBuffer,
+                              sidStems_t *stems);
+
+#endif
@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdint.h>
 #include <math.h>
@@ -5,7 +6,12 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "simple_sid.h" 
+#include "sid_automation.h"
+#include "sid_filter.h"
 
 
 /* --------------------------------------------------------------
@@ -162,40 +168,25 @@ int complex_main(void)
                               */
     /* So that means filterSel=0x10 => LP, masterVol=0xf => maximum. */
 
-    /* We'll produce 4 seconds of samples. For each sample:
-       - determine which note is playing for channel0
-       - set channel0 freq
-       - set filter cutoff proportionally to progress
-       - call bufferSamplesSid(...) with ~22 CPU cycles => yields ~1 sample
+    /* We'll produce 4 seconds of samples, one bufferSamplesSid call per note:
+       - set channel0 freq for the note
+       - the filter cutoff sweep runs as an automation ramp over the
+         whole 4s, so it doesn't need a call per sample
     */
-    for (int i = 0; i < totalSamples; i++) {
-        /* Which note of the scale are we on? */
-        int noteIndex = (i / samplesPerNote);
-        if (noteIndex >= notesCount) noteIndex = notesCount - 1;
-        float freq    = scaleFreqs[noteIndex];
-        regs.freq0    = freqToSidRegister(freq);
-
-        /* Ramp cutoff from 0..2047 across the entire 4s */
-        float frac  = (float)i / (float)(totalSamples - 1);
-        int cutoff  = (int)(frac * 255.0f + 0.5f);
-        if (cutoff > 255) cutoff = 255;
-        regs.cutoff = (int8_t)(cutoff & 0xff); /* low 8 bits used by the example code */
-
-        /* We want 1 sample at 44.1kHz => ~22.26 CPU cycles of PAL SID clock. 
-           Let's approximate int cycles=22.
-        */
-        int cyclesThisSample = 22;
-
-        /* Generate up to 1 sample. 
-           Typically bufferSamplesSid can produce more, but it depends on sid->cyclesPerSample.
-           We keep it in sync so it basically produces 1 sample each call. 
-        */
-        int n = bufferSamplesSid(&mySid, cyclesThisSample, &regs,
-                                 &waveData[i], 1, BUFFER_INT16, true);
-        if (n < 1) {
-            /* If we somehow didn't produce a sample, just force 0. */
-            waveData[i] = 0;
-        }
+    const int cyclesPerNote = (int)((int64_t)samplesPerNote * SID_CLOCK_PAL / sampleRate);
+    sidAutomation_t sweep;
+    sidAutomationInit(&sweep);
+
+    /* Ramp cutoff from 0..255 across the entire 4s */
+    sidAutomationRamp(&sweep, SID_PARAM_CUTOFF, SID_RAMP_LINEAR,
+                      0, (uint64_t)cyclesPerNote * notesCount, 0.0, 255.0);
+
+    int written = 0;
+    for (int noteIndex = 0; noteIndex < notesCount; noteIndex++) {
+        regs.freq0 = freqToSidRegister(scaleFreqs[noteIndex]);
+        written += bufferSamplesSidAutomated(&mySid, cyclesPerNote, &regs, &sweep,
+                                             &waveData[written], totalSamples - written,
+                                             BUFFER_INT16, true);
     }
 
     /* 6) Write the samples to a 16-bit mono .wav file at 44.1kHz */
@@ -269,8 +260,547 @@ int simple_main(void)
     return 0;
 }
 
+/* --------------------------------------------------------------
+   check_block_splits: a noise/sync/ring program rendered in one call
+   must match the same program split into 1-, 7- and 1001-cycle calls
+   -------------------------------------------------------------- */
+int check_block_splits(void)
+{
+    static const int splits[] = {1, 7, 1001};
+    const int cycles = 200000;
+    const int maxSamples = 10000;
+    int16_t *whole = (int16_t*)calloc(maxSamples, sizeof(int16_t));
+    int16_t *split = (int16_t*)calloc(maxSamples, sizeof(int16_t));
+    int failures = 0;
+    sidRegs_t regs;
+    sid_t a, b;
+
+    if (!whole || !split) {
+        fprintf(stderr, "Out of memory.\n");
+        free(whole);
+        free(split);
+        return 1;
+    }
+
+    memset(&regs, 0, sizeof(regs));
+    regs.freq0     = 0x7fff;
+    regs.waveform0 = 0x81;  /* noise + gate */
+    regs.freq1     = 0x1d45;
+    regs.waveform1 = 0x23;  /* saw + sync + gate */
+    regs.freq2     = 0x0461;
+    regs.waveform2 = 0x15;  /* triangle + ring + gate */
+    regs.ad0 = regs.ad1 = regs.ad2 = 0x08;
+    regs.sr0 = regs.sr1 = regs.sr2 = 0xc6;
+    regs.volume    = 0x0f;
+
+    sidInit(&a, 44100);
+    int n = bufferSamplesSid(&a, cycles, &regs, whole, maxSamples, BUFFER_INT16, true);
+
+    for (int s = 0; s < (int)(sizeof(splits) / sizeof(splits[0])); s++) {
+        int m = 0;
+        sidInit(&b, 44100);
+        for (int left = cycles; left > 0; left -= splits[s]) {
+            int step = (left < splits[s]) ? left : splits[s];
+            m += bufferSamplesSid(&b, step, &regs, &split[m], maxSamples - m, BUFFER_INT16, true);
+        }
+
+        int first = -1;
+        for (int i = 0; i < n && i < m; i++)
+            if (whole[i] != split[i]) { first = i; break; }
+        if (m != n || first >= 0 || memcmp(&a, &b, sizeof(sid_t)) != 0) {
+            printf("block split %d: %d samples (whole %d), first difference at sample %d\n",
+                   splits[s], m, n, first);
+            failures++;
+        }
+    }
+
+    printf("block splits: %s\n", failures ? "FAILED" : "ok");
+    free(whole);
+    free(split);
+    return failures ? 1 : 0;
+}
+
+/* --------------------------------------------------------------
+   check_envelope_skip: one channel clocked in long calls, which skip
+   whole rate periods while sustaining or released to zero, must
+   match the same channel clocked one cycle per call, which never
+   does. Covers sustain at each exp-counter period, switching from a
+   slow to a fast rate (the 15-bit rate counter wraps past the new
+   rate) and release to zero.
+   -------------------------------------------------------------- */
+int check_envelope_skip(void)
+{
+    static const uint8_t sustains[] = {0x0, 0x1, 0x3, 0x5, 0x6, 0xf};
+    static const struct {
+        uint8_t waveform, ad, release;
+        int cycles;
+    } phases[] = {
+        {0x11, 0x00, 0x0, 300001}, /* attack, decay, sustain */
+        {0x11, 0x0f, 0x0, 100003}, /* sustain at the slowest rate */
+        {0x11, 0x00, 0x0, 50001},  /* back to the fastest: counter wraps */
+        {0x10, 0x00, 0x3, 300007}, /* release to zero and stay there */
+        {0x10, 0x00, 0xf, 70001},
+        {0x10, 0x00, 0x0, 30011},
+    };
+    int failures = 0;
+    sid_t a, b;
+
+    for (int s = 0; s < (int)(sizeof(sustains) / sizeof(sustains[0])); s++) {
+        sidInit(&a, 44100);
+        sidInit(&b, 44100);
+        for (int p = 0; p < (int)(sizeof(phases) / sizeof(phases[0])); p++) {
+            sidChannel_t *ca = &a.channels[0];
+            sidChannel_t *cb = &b.channels[0];
+            ca->frequency = cb->frequency = 0x1000;
+            ca->waveform = cb->waveform = phases[p].waveform;
+            ca->ad = cb->ad = phases[p].ad;
+            ca->sr = cb->sr = (uint8_t)((sustains[s] << 4) | phases[p].release);
+
+            clockSidChannel(ca, phases[p].cycles);
+            for (int c = 0; c < phases[p].cycles; c++)
+                clockSidChannel(cb, 1);
+
+            if (memcmp(ca, cb, sizeof(sidChannel_t)) != 0) {
+                printf("envelope skip: sustain %x phase %d: level %u/%u counter %u/%u exp %u/%u\n",
+                       sustains[s], p, ca->volumeLevel, cb->volumeLevel, ca->adsrCounter,
+                       cb->adsrCounter, ca->adsrExpCounter, cb->adsrExpCounter);
+                failures++;
+                break;
+            }
+        }
+    }
+
+    printf("envelope skip: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
+/* --------------------------------------------------------------
+   check_state_only: rendering with no output buffer (the state-only
+   paths, including the one-call clocking while the filter is at
+   rest) must leave the chip exactly as rendering the samples does,
+   with the filter unused, routed, and left ringing.
+   -------------------------------------------------------------- */
+int check_state_only(void)
+{
+    static const uint8_t filterCtrls[] = {0x00, 0x00, 0x03, 0x00, 0xf1, 0x00};
+    static int16_t out[4096];
+    int failures = 0;
+    sidRegs_t regs;
+    sid_t a, b;
+
+    memset(&regs, 0, sizeof(regs));
+    regs.freq0 = 0x1234;
+    regs.pulse0 = 0x0800;
+    regs.freq1 = 0x0777;
+    regs.freq2 = 0x2345;
+    regs.ad0 = 0x25;
+    regs.ad1 = 0x0a;
+    regs.ad2 = 0x41;
+    regs.sr0 = regs.sr1 = regs.sr2 = 0x94;
+    regs.cutoff = 0x60;
+    regs.volume = 0x1f;
+
+    sidInit(&a, 44100);
+    sidInit(&b, 44100);
+    for (int e = 0; e < 60; e++) {
+        regs.waveform0 = (e % 4 == 3) ? 0x40 : 0x41;
+        regs.waveform1 = (e % 7 == 6) ? 0x20 : 0x21;
+        regs.waveform2 = (e % 5 < 2) ? 0x11 : 0x10;
+        regs.filterCtrl = filterCtrls[e % 6];
+        int cycles = 20011 + (e % 9) * 3001;
+
+        int n = bufferSamplesSid(&a, cycles, &regs, out, 4096, BUFFER_INT16, true);
+        int m = bufferSamplesSid(&b, cycles, &regs, NULL, 4096, BUFFER_INT16, true);
+        if (n != m || memcmp(&a, &b, sizeof(sid_t)) != 0) {
+            printf("state-only: event %d: %d samples (rendered %d) or chip state differs\n",
+                   e, m, n);
+            failures++;
+            break;
+        }
+    }
+
+    printf("state-only: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
+/* --------------------------------------------------------------
+   check_automation_ramps: a render with automation ramps must match
+   one bufferSamplesSid call per sample, fed the quantised ramp values
+   worked out here at each sample boundary. Frequency only affects
+   clocking, so a call clocks with the value from the previous
+   boundary; pulse, cutoff and volume only affect the output, so it
+   mixes with the value at its own boundary. Covers overlapping ramps
+   on one parameter, ramps starting and ending mid-block, a step
+   (zero-length ramp) and exponential shapes.
+   -------------------------------------------------------------- */
+static int32_t rampValueAt(const sidRamp_t *ramps, int numRamps, int param, uint64_t cycle)
+{
+    static const int32_t maxValue[SID_PARAM_COUNT] = {0xffff, 0xffff, 0xffff, 0x0fff,
+                                                      0x0fff, 0x0fff, 0xff, 0x0f};
+    const sidRamp_t *r = NULL;
+    for (int i = 0; i < numRamps; i++)
+        if (ramps[i].param == param && ramps[i].startCycle <= cycle &&
+            (!r || ramps[i].startCycle >= r->startCycle))
+            r = &ramps[i];
+    if (!r)
+        return -1;
+
+    double v = r->to;
+    if (cycle < r->endCycle) {
+        double t = (double)(cycle - r->startCycle) / (double)(r->endCycle - r->startCycle);
+        v = (r->shape == SID_RAMP_EXPONENTIAL) ? r->from * pow(r->to / r->from, t)
+                                               : r->from + (r->to - r->from) * t;
+    }
+    v = floor(v + 0.5);
+    return (v < 0.0) ? 0 : (v > maxValue[param]) ? maxValue[param] : (int32_t)v;
+}
+
+static void rampRegs(const sidRegs_t *regs, const int32_t *freq, const int32_t *out, sidRegs_t *r)
+{
+    int16_t *freqs[3] = {&r->freq0, &r->freq1, &r->freq2};
+    int16_t *pulses[3] = {&r->pulse0, &r->pulse1, &r->pulse2};
+    *r = *regs;
+    for (int v = 0; v < 3; v++) {
+        if (freq[SID_PARAM_FREQ0 + v] >= 0)
+            *freqs[v] = (int16_t)freq[SID_PARAM_FREQ0 + v];
+        if (out[SID_PARAM_PULSE0 + v] >= 0)
+            *pulses[v] = (int16_t)out[SID_PARAM_PULSE0 + v];
+    }
+    if (out[SID_PARAM_CUTOFF] >= 0)
+        r->cutoff = (int8_t)out[SID_PARAM_CUTOFF];
+    if (out[SID_PARAM_VOLUME] >= 0)
+        r->volume = (int8_t)((r->volume & 0xf0) | out[SID_PARAM_VOLUME]);
+}
+
+int check_automation_ramps(void)
+{
+    static const sidRamp_t ramps[] = {
+        /* startCycle, endCycle, from, to, param, shape */
+        {0, 150000, 0x0400, 0x3000, SID_PARAM_FREQ0, SID_RAMP_LINEAR},
+        {90001, 250003, 0x5000, 0x0100, SID_PARAM_FREQ0, SID_RAMP_LINEAR}, /* overrides */
+        {20011, 123457, 0x100, 0xf00, SID_PARAM_PULSE0, SID_RAMP_EXPONENTIAL},
+        {7, 99991, 0x0200, 0x9000, SID_PARAM_FREQ1, SID_RAMP_EXPONENTIAL},
+        {60013, 60013, 0, 0x0123, SID_PARAM_FREQ1, SID_RAMP_LINEAR},    /* a step */
+        {61001, 180001, 0x0123, 0x4567, SID_PARAM_FREQ1, SID_RAMP_LINEAR},
+        {0, 400000, 0xe00, 0x080, SID_PARAM_PULSE1, SID_RAMP_LINEAR},
+        {100003, 140009, 0x800, 0x7ff, SID_PARAM_PULSE1, SID_RAMP_LINEAR}, /* one step */
+        {33331, 211111, 0x0100, 0x0800, SID_PARAM_FREQ2, SID_RAMP_LINEAR},
+        {50021, 300001, 10, 240, SID_PARAM_CUTOFF, SID_RAMP_LINEAR},
+        {0, 333331, 15, 2, SID_PARAM_VOLUME, SID_RAMP_LINEAR},
+        {350003, 360007, 2, 14, SID_PARAM_VOLUME, SID_RAMP_EXPONENTIAL},
+    };
+    const int numRamps = (int)(sizeof(ramps) / sizeof(ramps[0]));
+    const int maxSamples = 16384;
+    float *automated = (float*)calloc(maxSamples, sizeof(float));
+    float *reference = (float*)calloc(maxSamples, sizeof(float));
+    int32_t cur[SID_PARAM_COUNT], next[SID_PARAM_COUNT];
+    int failures = 0;
+    sidAutomation_t autom;
+    sidRegs_t regs, r;
+    sid_t a, b;
+
+    if (!automated || !reference) {
+        fprintf(stderr, "Out of memory.\n");
+        free(automated);
+        free(reference);
+        return 1;
+    }
+
+    memset(&regs, 0, sizeof(regs));
+    regs.freq0 = 0x1000;
+    regs.pulse0 = 0x0800;
+    regs.waveform0 = 0x41;  /* pulse + gate */
+    regs.freq1 = 0x0777;
+    regs.pulse1 = 0x0400;
+    regs.waveform1 = 0x41;
+    regs.freq2 = 0x2345;
+    regs.waveform2 = 0x21;  /* saw + gate */
+    regs.ad0 = regs.ad1 = regs.ad2 = 0x22;
+    regs.sr0 = regs.sr1 = regs.sr2 = 0xa4;
+    regs.cutoff = 0x40;
+    regs.filterCtrl = 0x63; /* voices 0 and 1 through the filter */
+    regs.volume = 0x18;     /* low-pass, volume 8 */
+
+    sidInit(&a, 44100);
+    sidInit(&b, 44100);
+    sidAutomationInit(&autom);
+    for (int i = 0; i < numRamps; i++)
+        sidAutomationRamp(&autom, (sidParam_t)ramps[i].param, (sidRampShape_t)ramps[i].shape,
+                          ramps[i].startCycle, ramps[i].endCycle, ramps[i].from, ramps[i].to);
+
+    uint64_t cycle = 0;
+    for (int p = 0; p < SID_PARAM_COUNT; p++)
+        cur[p] = rampValueAt(ramps, numRamps, p, 0);
+
+    for (int e = 0; e < 48; e++) {
+        int cycles = 5003 + (e % 7) * 1777;
+        regs.waveform2 = (e % 11 == 10) ? 0x20 : 0x21;
+
+        int n = bufferSamplesSidAutomated(&a, cycles, &regs, &autom, automated, maxSamples,
+                                          BUFFER_FLOAT, true);
+
+        /* The reference, one call per sample boundary */
+        int m = 0;
+        for (int left = cycles; left > 0;) {
+            uint64_t needed = b.cyclesPerSample - b.cycleAccumulator;
+            int step = (int)((needed + ((uint64_t)1 << SID_PHASE_BITS) - 1) >> SID_PHASE_BITS);
+            if (step > left) {
+                /* No boundary before the event ends */
+                rampRegs(&regs, cur, cur, &r);
+                bufferSamplesSid(&b, left, &r, NULL, 1, BUFFER_FLOAT, true);
+                cycle += (uint64_t)left;
+                break;
+            }
+            for (int p = 0; p < SID_PARAM_COUNT; p++)
+                next[p] = rampValueAt(ramps, numRamps, p, cycle + (uint64_t)step);
+            rampRegs(&regs, cur, next, &r);
+            m += bufferSamplesSid(&b, step, &r, &reference[m], 1, BUFFER_FLOAT, true);
+            memcpy(cur, next, sizeof(cur));
+            cycle += (uint64_t)step;
+            left -= step;
+        }
+
+        /* The latched frequency and pulse registers are written at
+           different points; only what they produce is compared */
+        sid_t latched = a;
+        for (int v = 0; v < 3; v++) {
+            latched.channels[v].frequency = b.channels[v].frequency;
+            latched.channels[v].pulse = b.channels[v].pulse;
+        }
+        int first = -1;
+        for (int i = 0; i < n && i < m; i++)
+            if (memcmp(&automated[i], &reference[i], sizeof(float)) != 0) { first = i; break; }
+        if (n != m || first >= 0 || memcmp(&latched, &b, sizeof(sid_t)) != 0) {
+            printf("automation ramps: event %d: %d samples (reference %d), first difference at sample %d\n",
+                   e, n, m, first);
+            failures++;
+            break;
+        }
+    }
+
+    printf("automation ramps: %s\n", failures ? "FAILED" : "ok");
+    free(automated);
+    free(reference);
+    return failures ? 1 : 0;
+}
+
+/* --------------------------------------------------------------
+   check_filter_splits: the oversampled filter's coefficient ramps
+   carry on across calls, so a stream filtered one sample per call
+   must match the same stream filtered in longer calls, at 1x, 2x and
+   4x, with a new cutoff arriving before the last ramp has finished.
+   The same holds for register events rendered through
+   bufferSamplesSidOversampled whole and in 1001-cycle pieces.
+   -------------------------------------------------------------- */
+static void filterInCalls(int oversample, int call, const float *in, float *out, int numSamples)
+{
+    static const int edges[] = {0, 500, 520, 1400};
+    static const float cutoffs[] = {0.1f, 0.6f, 0.3f, 0.9f};
+    sidFilterOs_t f;
+
+    sidFilterOsInit(&f, oversample);
+    for (int s = 0; s < 4; s++) {
+        int end = (s < 3) ? edges[s + 1] : numSamples;
+        for (int i = edges[s]; i < end; i += call) {
+            int n = (end - i < call) ? end - i : call;
+            sidFilterOsBlock(&f, in + i, out + i, n, cutoffs[s], 1.5f, 0x10);
+        }
+    }
+}
+
+int check_filter_splits(void)
+{
+    static const int calls[] = {2, 3, 7, 64, 100, 2000};
+    static float in[2000], one[2000], split[2000];
+    static int16_t whole16[8192], split16[8192];
+    const int numSamples = 2000;
+    int failures = 0;
+    sidFilterOs_t fa, fb;
+    sidRegs_t regs;
+    sid_t a, b;
+
+    for (int i = 0; i < numSamples; i++)
+        in[i] = ((i / 7) & 1) ? 0.5f : -0.5f;
+
+    for (int os = 1; os <= SID_FILTER_MAX_OVERSAMPLE; os *= 2) {
+        filterInCalls(os, 1, in, one, numSamples);
+        for (int c = 0; c < (int)(sizeof(calls) / sizeof(calls[0])); c++) {
+            filterInCalls(os, calls[c], in, split, numSamples);
+            if (memcmp(one, split, sizeof(one)) != 0) {
+                printf("filter splits: %dx, %d-sample calls differ from 1-sample calls\n",
+                       os, calls[c]);
+                failures++;
+            }
+        }
+    }
+
+    memset(&regs, 0, sizeof(regs));
+    regs.freq0 = 0x1d45;
+    regs.waveform0 = 0x21;  /* saw + gate */
+    regs.freq1 = 0x0461;
+    regs.pulse1 = 0x0600;
+    regs.waveform1 = 0x41;  /* pulse + gate */
+    regs.ad0 = regs.ad1 = 0x08;
+    regs.sr0 = regs.sr1 = 0xc6;
+    regs.filterCtrl = (int8_t)0xa3;
+    regs.volume = 0x3f;     /* low-pass + band-pass, volume 15 */
+
+    sidInit(&a, 44100);
+    sidInit(&b, 44100);
+    sidFilterOsInit(&fa, 2);
+    sidFilterOsInit(&fb, 2);
+    for (int e = 0; e < 24 && !failures; e++) {
+        int cycles = 3001 + (e % 5) * 2203;
+        regs.cutoff = (int8_t)(0x10 + (e * 37) % 0x60);
+
+        int n = bufferSamplesSidOversampled(&a, cycles, &regs, &fa, whole16, 8192,
+                                            BUFFER_INT16, true);
+        int m = 0;
+        for (int left = cycles; left > 0; left -= 1001) {
+            int step = (left < 1001) ? left : 1001;
+            m += bufferSamplesSidOversampled(&b, step, &regs, &fb, &split16[m], 8192 - m,
+                                             BUFFER_INT16, true);
+        }
+        if (n != m || memcmp(whole16, split16, (size_t)n * sizeof(int16_t)) != 0 ||
+            memcmp(&a, &b, sizeof(sid_t)) != 0 || memcmp(&fa, &fb, sizeof(fa)) != 0) {
+            printf("filter splits: event %d rendered in pieces differs\n", e);
+            failures++;
+        }
+    }
+
+    printf("filter splits: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
+/* --------------------------------------------------------------
+   check_arena: allocation order and alignment, bulk allocation past
+   capacity, clones, free and FreeAll, the byte count, and that a
+   double free or a foreign pointer is caught. With asserts on, the
+   bad free runs in a child that must abort; with them compiled out
+   it must leave the free list alone.
+   -------------------------------------------------------------- */
+static bool arenaFreeRejected(sidArena_t *arena, sid_t *sid)
+{
+#ifdef NDEBUG
+    uint32_t freeCount = arena->freeCount;
+    sidArenaFree(arena, sid);
+    return arena->freeCount == freeCount;
+#else
+    int status;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0) {
+        freopen("/dev/null", "w", stderr);
+        sidArenaFree(arena, sid);
+        _exit(0);
+    }
+    if (waitpid(pid, &status, 0) != pid)
+        return false;
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+#endif
+}
+
+int check_arena(void)
+{
+    const uint32_t capacity = 8;
+    sid_t *chips[10];
+    sidArena_t arena;
+    sidRegs_t regs;
+    sid_t fresh, outside;
+    int failures = 0;
+
+    if (!sidArenaInit(&arena, capacity)) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    sidInit(&fresh, 44100);
+    sidInit(&outside, 44100);
+
+    if (sidArenaBytes(&arena) !=
+        sizeof(arena) + capacity * (sizeof(sid_t) + sizeof(uint32_t) + sizeof(uint8_t))) {
+        printf("arena: %zu bytes reported\n", sidArenaBytes(&arena));
+        failures++;
+    }
+
+    /* Lowest slot first, aligned, initialised */
+    sid_t *first = sidArenaAlloc(&arena, 44100);
+    if (first != &arena.slots[0] || (uintptr_t)first % SID_ALIGN != 0 ||
+        memcmp(first, &fresh, sizeof(sid_t)) != 0) {
+        printf("arena: first allocation is not an initialised slot 0\n");
+        failures++;
+    }
+
+    /* Bulk allocation stops at capacity */
+    uint32_t got = sidArenaAllocBulk(&arena, chips, 10, 44100);
+    if (got != capacity - 1 || sidArenaAlloc(&arena, 44100) || sidArenaClone(&arena, first)) {
+        printf("arena: bulk allocation gave %u of %u free slots\n", got, capacity - 1);
+        failures++;
+    }
+    for (uint32_t i = 0; i < got; i++)
+        if (chips[i] != &arena.slots[i + 1]) {
+            printf("arena: bulk chip %u is not slot %u\n", i, i + 1);
+            failures++;
+            break;
+        }
+
+    /* A freed slot is reused by a clone, which copies the chip */
+    memset(&regs, 0, sizeof(regs));
+    regs.freq0 = 0x1234;
+    regs.waveform0 = 0x21;
+    regs.ad0 = 0x22;
+    regs.sr0 = 0xa4;
+    regs.volume = 0x0f;
+    bufferSamplesSid(first, 30011, &regs, NULL, 4096, BUFFER_INT16, true);
+    sid_t *freed = chips[3];
+    sidArenaFree(&arena, freed);
+    sidArenaFree(&arena, NULL);
+    sid_t *clone = sidArenaClone(&arena, first);
+    if (clone != freed || memcmp(clone, first, sizeof(sid_t)) != 0 || arena.freeCount != 0) {
+        printf("arena: clone did not reuse the freed slot as a copy\n");
+        failures++;
+    }
+
+    /* Double free and foreign pointers */
+    sidArenaFree(&arena, clone);
+    if (!arenaFreeRejected(&arena, clone)) {
+        printf("arena: double free not caught\n");
+        failures++;
+    }
+    if (!arenaFreeRejected(&arena, &outside)) {
+        printf("arena: foreign pointer not caught\n");
+        failures++;
+    }
+
+    /* FreeAll hands the slots out from the bottom again */
+    sidArenaFreeAll(&arena);
+    if (arena.freeCount != capacity || sidArenaAlloc(&arena, 44100) != &arena.slots[0]) {
+        printf("arena: FreeAll did not release every slot\n");
+        failures++;
+    }
+
+    sidArenaDestroy(&arena);
+    if (arena.slots || arena.capacity != 0) {
+        printf("arena: destroy left slots behind\n");
+        failures++;
+    }
+
+    printf("arena: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "check") == 0) {
+        int failures = check_block_splits();
+        failures += check_envelope_skip();
+        failures += check_state_only();
+        failures += check_automation_ramps();
+        failures += check_filter_splits();
+        failures += check_arena();
+        return failures ? 1 : 0;
+    }
     return complex_main();
  
 }
\ No newline at end of file
@@ -0,0 +1,1364 @@
+/* ------------------------------------------------------------------
+   sid_verify: differential render verifier.
+
+   Renders register programs through the reference path (one
+   bufferSamplesSid call per event) and through each alternative
+   engine, then compares the output sample by sample (bitwise) and
+   the chip state at checkpoints (after every event for engines that
+   go event by event, at the end for the others). The first
+   divergence per engine and program is reported with the surrounding
+   samples and the event that produced it.
+
+   The reference itself is checked the same way against a naive model
+   that steps the chip one cycle at a time, and automation ramps are
+   checked against that model fed the same ramps. The oversampled
+   filter at 1x is compared within VERIFY_OS_TOLERANCE, since it
+   rearranges the filter arithmetic.
+
+   Programs are pseudo-random (reproducible from the seed), a small
+   built-in corpus modelled on the demos, and any register logs given
+   on the command line (int32 rows of SID_EVENT_COLUMNS: cycles, then
+   the sidRegs_t fields, as sid_server and the Python bindings use).
+
+   Usage: ./sid_verify [-n programs] [-s seed] [log files...]
+   Exits with 1 if any engine diverges.
+   ------------------------------------------------------------------ */
+#include <float.h>
+#include "simple_sid.h"
+#include "sid_analysis.h"
+#include "sid_automation.h"
+#include "sid_cache.h"
+#include "sid_filter.h"
+#include "sid_rt.h"
+#include "sid_segment.h"
+#include "sid_stems.h"
+
+#define VERIFY_DEFAULT_PROGRAMS 100
+#define VERIFY_DEFAULT_SEED 0x5eed
+#define VERIFY_MAX_EVENTS 96
+#define VERIFY_CONTEXT 3 /* samples shown either side of a divergence */
+#define VERIFY_THREADS 3
+#define VERIFY_MAX_RAMPS 6
+#define VERIFY_OS_TOLERANCE 1e-6f /* oversampled filter at 1x vs sidFilterStep; measured under 1e-7 */
+
+typedef struct
+{
+    char name[64];
+    sidEvent_t *events;
+    int32_t numEvents;
+    int32_t sampleRate;
+    int bufferType;
+    uint64_t seed; /* for engines that make random choices */
+} program_t;
+
+/* ------------------------------------------------------------------
+   Engines. Each renders the whole program from 'sid' into 'out' and
+   may record the chip state after every event in 'checkpoints'
+   (NULL if the engine can't). Returns the number of samples
+   produced, or -1 if the engine failed a self-check.
+   ------------------------------------------------------------------ */
+typedef int32_t (*engineFn_t)(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                              sid_t *checkpoints);
+
+/* The first event after which an engine stops being exact on a
+   program, given the reference checkpoints (numEvents if it never
+   does). Its samples up to the end of that event are still compared.
+   NULL means always exact. */
+typedef int32_t (*exactUntilFn_t)(const program_t *p, const sid_t *refCheckpoints);
+
+typedef struct
+{
+    const char *name;
+    engineFn_t run;
+    bool hasCheckpoints;
+    bool hasOutput;
+    exactUntilFn_t exactUntil;
+    float tolerance;   /* 0: samples must match bitwise; else the largest
+                          difference allowed (float scale), and the filter
+                          state, which the engine keeps elsewhere, isn't
+                          compared */
+    bool ownReference; /* run() checks itself against the naive model;
+                          only the sample count is compared */
+} engine_t;
+
+/* The C++ layer's engines (sid_verify_cpp.cpp) */
+int32_t verifyCppRender(sid_t *sid, int32_t sampleRate, const sidEvent_t *events,
+                        int32_t numEvents, void *out, int32_t maxSamples, int bufferType,
+                        sid_t *checkpoints);
+int32_t verifyCppRenderLockstep(sid_t *sid, int32_t sampleRate, const sidEvent_t *events,
+                                int32_t numEvents, void *out, int32_t maxSamples, int bufferType,
+                                sid_t *checkpoints);
+
+static uint64_t rngNext(uint64_t *s)
+{
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545f4914f6cdd1dull;
+}
+
+static uint32_t rngRange(uint64_t *s, uint32_t n)
+{
+    return (uint32_t)(rngNext(s) % n);
+}
+
+static size_t sampleBytes(int bufferType)
+{
+    return (bufferType == BUFFER_INT16) ? sizeof(int16_t) : sizeof(float);
+}
+
+static void *sampleAt(void *out, int32_t index, int bufferType)
+{
+    return out ? (char *)out + (size_t)index * sampleBytes(bufferType) : NULL;
+}
+
+static bool stateDiffers(const sid_t *ref, const sid_t *alt, char *what, size_t size);
+static double sampleValue(const void *out, int32_t i, int bufferType);
+
+/* The reference: what sidRenderEvents does, with checkpoints */
+static int32_t runReference(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                            sid_t *checkpoints)
+{
+    int32_t produced = 0;
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        produced += bufferSamplesSid(sid, p->events[i].cycles, &p->events[i].regs,
+                                     sampleAt(out, produced, p->bufferType),
+                                     maxSamples - produced, p->bufferType, true);
+        checkpoints[i] = *sid;
+    }
+    return produced;
+}
+
+/* Every event split into random chunks, down to single cycles */
+static int32_t runBlockSplits(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                              sid_t *checkpoints)
+{
+    uint64_t rng = p->seed;
+    int32_t produced = 0;
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        int32_t left = p->events[i].cycles;
+        while (left > 0)
+        {
+            int32_t chunk;
+            switch (rngRange(&rng, 4))
+            {
+            case 0:
+                chunk = 1;
+                break;
+            case 1:
+                chunk = 1 + (int32_t)rngRange(&rng, 64);
+                break;
+            default:
+                chunk = 1 + (int32_t)rngRange(&rng, 20000);
+                break;
+            }
+            if (chunk > left)
+                chunk = left;
+            produced += bufferSamplesSid(sid, chunk, &p->events[i].regs,
+                                         sampleAt(out, produced, p->bufferType),
+                                         maxSamples - produced, p->bufferType, true);
+            left -= chunk;
+        }
+        checkpoints[i] = *sid;
+    }
+    return produced;
+}
+
+/* No output buffer: the state-only fast paths */
+static int32_t runStateOnly(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                            sid_t *checkpoints)
+{
+    int32_t produced = 0;
+    (void)out;
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        produced += bufferSamplesSid(sid, p->events[i].cycles, &p->events[i].regs, NULL,
+                                     maxSamples - produced, p->bufferType, true);
+        checkpoints[i] = *sid;
+    }
+    return produced;
+}
+
+/* One pool for the whole run, so its workers are reused across programs */
+static sidSegmentPool_t pool;
+
+static int32_t runParallel(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                           sid_t *checkpoints)
+{
+    (void)checkpoints;
+    return sidRenderEventsPooled(&pool, sid, p->events, p->numEvents, out, maxSamples,
+                                 p->bufferType);
+}
+
+static sidCache_t cache;
+
+static int32_t runCacheMiss(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                            sid_t *checkpoints)
+{
+    (void)checkpoints;
+    sidCacheClear(&cache);
+    return sidCacheRender(&cache, sid, p->events, p->numEvents, out, maxSamples, p->bufferType);
+}
+
+/* Fill the cache from a copy of the chip, then render again as a hit */
+static int32_t runCacheHit(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                           sid_t *checkpoints)
+{
+    sid_t warm;
+    (void)checkpoints;
+    sidCacheClear(&cache);
+    memcpy(&warm, sid, sizeof(sid_t));
+    sidCacheRender(&cache, &warm, p->events, p->numEvents, NULL, maxSamples, p->bufferType);
+
+    uint64_t hits = cache.stats.hits;
+    if (!sidCacheVerify(&cache, sid, p->events, p->numEvents, maxSamples, p->bufferType))
+    {
+        printf("    sidCacheVerify failed\n");
+        return -1;
+    }
+    int32_t produced = sidCacheRender(&cache, sid, p->events, p->numEvents, out, maxSamples,
+                                      p->bufferType);
+    if (cache.stats.hits != hits + 1)
+    {
+        printf("    expected a cache hit\n");
+        return -1;
+    }
+    return produced;
+}
+
+static int32_t runAnalysis(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                           sid_t *checkpoints)
+{
+    static sidNoteEvent_t notes[256];
+    static sidBlockStats_t blocks[64];
+    sidAnalysis_t an;
+    int32_t produced = 0;
+    sidAnalysisInit(&an, notes, 256, blocks, 64, 1024);
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        produced += bufferSamplesSidAnalysis(sid, p->events[i].cycles, &p->events[i].regs,
+                                             sampleAt(out, produced, p->bufferType),
+                                             maxSamples - produced, p->bufferType, true, &an);
+        checkpoints[i] = *sid;
+    }
+    sidAnalysisFlush(&an);
+    return produced;
+}
+
+/* Stems attached; for float output the mix stem must equal the output */
+static int32_t runStems(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                        sid_t *checkpoints)
+{
+    float *mix = (float *)malloc((size_t)maxSamples * sizeof(float));
+    float *voice = (float *)malloc((size_t)maxSamples * sizeof(float));
+    sidStems_t stems;
+    int32_t produced = 0;
+    if (!mix || !voice)
+    {
+        free(mix);
+        free(voice);
+        return -1;
+    }
+
+    sidStemsInit(&stems, (uint32_t)maxSamples);
+    stems.mix = mix;
+    stems.voicePost[0] = voice;
+    stems.filter = voice; /* overwritten; only exercises the path */
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        produced += bufferSamplesSidStems(sid, p->events[i].cycles, &p->events[i].regs,
+                                          sampleAt(out, produced, p->bufferType),
+                                          maxSamples - produced, p->bufferType, true, &stems);
+        checkpoints[i] = *sid;
+    }
+
+    bool mixOk = p->bufferType != BUFFER_FLOAT ||
+                 memcmp(mix, out, (size_t)produced * sizeof(float)) == 0;
+    free(mix);
+    free(voice);
+    if (!mixOk)
+    {
+        printf("    mix stem differs from the output\n");
+        return -1;
+    }
+    return produced;
+}
+
+static int32_t runAutomation(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                             sid_t *checkpoints)
+{
+    sidAutomation_t a;
+    int32_t produced = 0;
+    sidAutomationInit(&a);
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        produced += bufferSamplesSidAutomated(sid, p->events[i].cycles, &p->events[i].regs, &a,
+                                              sampleAt(out, produced, p->bufferType),
+                                              maxSamples - produced, p->bufferType, true);
+        checkpoints[i] = *sid;
+    }
+    return produced;
+}
+
+/* ------------------------------------------------------------------
+   Real-time mode. sidRtRender renders a sample count rather than a
+   cycle count and stops on the last sample, so each event is rendered
+   as the samples it yields, and the cycles left before the event ends
+   are then clocked with no output. Matches the reference exactly
+   unless the per-block denormal flush changed the filter state.
+   ------------------------------------------------------------------ */
+static sidRt_t rt;
+
+static int32_t runRt(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                     sid_t *checkpoints)
+{
+    int32_t produced = 0;
+    sidRtInit(&rt, p->sampleRate);
+    rt.sid = *sid;
+    for (int32_t i = 0; i < p->numEvents && produced < maxSamples; i++)
+    {
+        const sidEvent_t *ev = &p->events[i];
+        uint64_t cps = rt.sid.cyclesPerSample;
+        uint64_t before = rt.sid.cycleAccumulator;
+        int64_t n = 0;
+        if (ev->cycles > 0)
+            n = (int64_t)((before + ((uint64_t)ev->cycles << SID_PHASE_BITS)) / cps);
+        if (n > maxSamples - produced)
+            n = maxSamples - produced; /* the reference stops mid-event too */
+
+        int32_t left = ev->cycles;
+        if (n > 0)
+        {
+            produced += sidRtRender(&rt, &ev->regs, sampleAt(out, produced, p->bufferType),
+                                    (int32_t)n, p->bufferType);
+            /* Cycles used: the phase advanced by them, less n samples */
+            uint64_t used = (rt.sid.cycleAccumulator + (uint64_t)n * cps - before) >> SID_PHASE_BITS;
+            left -= (int32_t)used;
+        }
+        if (produced < maxSamples &&
+            bufferSamplesSid(&rt.sid, left, &ev->regs, NULL, 1, p->bufferType, true) != 0)
+        {
+            printf("    event %d: a sample fell after the RT block\n", i);
+            return -1;
+        }
+        checkpoints[i] = rt.sid;
+    }
+    *sid = rt.sid;
+    return produced;
+}
+
+/* The flush first matters where the reference filter state is
+   denormal at the end of an RT block, i.e. after some event */
+static int32_t rtExactUntil(const program_t *p, const sid_t *refCheckpoints)
+{
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        float low = refCheckpoints[i].filter.low;
+        float band = refCheckpoints[i].filter.band;
+        if ((low != 0.f && fabsf(low) < FLT_MIN) || (band != 0.f && fabsf(band) < FLT_MIN))
+            return i;
+    }
+    return p->numEvents;
+}
+
+static int32_t runCpp(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                      sid_t *checkpoints)
+{
+    return verifyCppRender(sid, p->sampleRate, p->events, p->numEvents, out, maxSamples,
+                           p->bufferType, checkpoints);
+}
+
+static int32_t runCppLockstep(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                              sid_t *checkpoints)
+{
+    return verifyCppRenderLockstep(sid, p->sampleRate, p->events, p->numEvents, out, maxSamples,
+                                   p->bufferType, checkpoints);
+}
+
+/* ------------------------------------------------------------------
+   Naive model: the chip stepped one cycle at a time, with none of the
+   core's shortcuts (no envelope period skipping, no edge scheduling,
+   no state-only paths, no per-format kernels). Noise and sync fire on
+   the bit 19 / bit 23 rising edges seen cycle by cycle, and automation
+   ramps are evaluated afresh at every sample boundary. Only the
+   waveform lookup (getOutputSidChannel) and the filter (sidFilterStep)
+   are taken from the core.
+   ------------------------------------------------------------------ */
+static const uint16_t naiveRates[16] = {SID_ADSR_RATES};
+static const uint8_t naiveSustain[16] = {SID_SUSTAIN_LEVELS};
+
+typedef struct
+{
+    const sidRamp_t *ramps;
+    uint32_t numRamps;
+    uint64_t cycle;
+    int32_t value[SID_PARAM_COUNT]; /* -1 = follow the register */
+} naiveAutomation_t;
+
+/* Envelope steps per exponential decay step, by level. The core's
+   table stops listing at 0x58, and levels past it step every time. */
+static unsigned naiveExpPeriod(uint8_t level)
+{
+    if (level == 0 || level >= 0x59)
+        return 1;
+    if (level >= 0x34)
+        return 2;
+    if (level >= 0x1a)
+        return 4;
+    if (level >= 0x0e)
+        return 8;
+    if (level >= 0x06)
+        return 16;
+    return 30;
+}
+
+static void naiveEnvelopeCycle(sidChannel_t *ch)
+{
+    if (!(ch->waveform & 0x01))
+        ch->state = RELEASE;
+    else if (ch->state == RELEASE)
+        ch->state = ATTACK;
+
+    unsigned nibble = (ch->state == ATTACK)  ? (unsigned)(ch->ad >> 4)
+                      : (ch->state == DECAY) ? (unsigned)(ch->ad & 0x0f)
+                                             : (unsigned)(ch->sr & 0x0f);
+    ch->adsrCounter = (uint16_t)((ch->adsrCounter + 1) & 0x7fff);
+    if (ch->adsrCounter != naiveRates[nibble])
+        return;
+    ch->adsrCounter = 0;
+
+    if (ch->state == ATTACK)
+    {
+        ch->adsrExpCounter = 0;
+        if (++ch->volumeLevel == 0xff)
+            ch->state = DECAY;
+    }
+    else if (ch->state == DECAY || ch->volumeLevel > 0)
+    {
+        if (++ch->adsrExpCounter >= naiveExpPeriod(ch->volumeLevel))
+        {
+            ch->adsrExpCounter = 0;
+            if (ch->state == RELEASE || ch->volumeLevel > naiveSustain[ch->sr >> 4])
+                ch->volumeLevel--;
+        }
+    }
+}
+
+static void naiveClockCycle(sid_t *sid)
+{
+    sidChannel_t *ch = sid->channels;
+    bool crossed[3];
+    int i;
+    for (i = 0; i < 3; i++)
+    {
+        naiveEnvelopeCycle(&ch[i]);
+
+        unsigned before = ch[i].accumulator;
+        if (ch[i].waveform & 0x08)
+            ch[i].accumulator = 0;
+        else
+            ch[i].accumulator = (before + ch[i].frequency) & 0xffffff;
+        unsigned rose = ~before & ch[i].accumulator;
+
+        if ((ch[i].waveform & 0x80) && (rose & 0x80000))
+        {
+            unsigned lfsr = ch[i].noiseGenerator;
+            unsigned bit = ((lfsr >> 22) ^ (lfsr >> 17)) & 1;
+            ch[i].noiseGenerator = ((lfsr << 1) | bit) & 0x7fffff;
+        }
+        crossed[i] = (ch[(i + 1) % 3].waveform & 0x02) && (rose & 0x800000);
+    }
+    for (i = 0; i < 3; i++)
+        if (crossed[i])
+            ch[(i + 1) % 3].accumulator = 0;
+}
+
+/* The latest-starting ramp of each parameter that has begun, quantised */
+static void naiveAutomationEval(naiveAutomation_t *a)
+{
+    static const int32_t maxValue[SID_PARAM_COUNT] = {0xffff, 0xffff, 0xffff, 0x0fff,
+                                                      0x0fff, 0x0fff, 0xff, 0x0f};
+    for (int p = 0; p < SID_PARAM_COUNT; p++)
+    {
+        const sidRamp_t *best = NULL;
+        for (uint32_t i = 0; i < a->numRamps; i++)
+        {
+            const sidRamp_t *r = &a->ramps[i];
+            if (r->param == p && r->startCycle <= a->cycle &&
+                (!best || r->startCycle >= best->startCycle))
+                best = r;
+        }
+        if (!best)
+        {
+            a->value[p] = -1;
+            continue;
+        }
+
+        double v = best->to;
+        if (a->cycle < best->endCycle)
+        {
+            double t = (double)(a->cycle - best->startCycle) /
+                       (double)(best->endCycle - best->startCycle);
+            v = (best->shape == SID_RAMP_EXPONENTIAL)
+                    ? best->from * exp(t * log(best->to / best->from))
+                    : best->from + (best->to - best->from) * t;
+        }
+        v = floor(v + 0.5);
+        a->value[p] = (v < 0.0) ? 0 : (v > maxValue[p]) ? maxValue[p] : (int32_t)v;
+    }
+}
+
+static void naiveAutomationApply(const naiveAutomation_t *a, sid_t *sid, sidMix_t *mix)
+{
+    for (int v = 0; v < 3; v++)
+    {
+        if (a->value[SID_PARAM_FREQ0 + v] >= 0)
+            sid->channels[v].frequency = (uint16_t)a->value[SID_PARAM_FREQ0 + v];
+        if (a->value[SID_PARAM_PULSE0 + v] >= 0)
+            sid->channels[v].pulse = (uint16_t)a->value[SID_PARAM_PULSE0 + v];
+    }
+    if (a->value[SID_PARAM_CUTOFF] >= 0)
+        mix->cutoff = sidCutoffFromReg((int8_t)a->value[SID_PARAM_CUTOFF]);
+    if (a->value[SID_PARAM_VOLUME] >= 0)
+        mix->masterVol = (float)a->value[SID_PARAM_VOLUME] / 22.5f;
+}
+
+/* One event of bufferSamplesSid (or bufferSamplesSidAutomated if 'a') */
+static int32_t naiveRender(sid_t *sid, int cycles, const sidRegs_t *regs, naiveAutomation_t *a,
+                           void *out, int32_t maxSamples, int bufferType)
+{
+    sidMix_t base;
+    sidMix_t mix;
+    int32_t produced = 0;
+    if (cycles <= 0 || maxSamples <= 0)
+        return 0; /* the registers aren't latched either */
+    sidSetRegs(sid, regs);
+    sidMixFromRegs(regs, &base);
+    mix = base;
+    if (a)
+        naiveAutomationApply(a, sid, &mix);
+
+    while (cycles > 0 && produced < maxSamples)
+    {
+        if (sid->cycleAccumulator < sid->cyclesPerSample)
+        {
+            naiveClockCycle(sid);
+            cycles--;
+            if (a)
+                a->cycle++;
+            sid->cycleAccumulator += SID_PHASE_ONE;
+            if (sid->cycleAccumulator < sid->cyclesPerSample)
+                continue;
+        }
+        sid->cycleAccumulator -= sid->cyclesPerSample;
+
+        if (a)
+        {
+            naiveAutomationEval(a);
+            mix = base;
+            naiveAutomationApply(a, sid, &mix);
+        }
+
+        float sample = 0.f;
+        float fin = 0.f;
+        float filtered;
+        for (int i = 0; i < 3; i++)
+        {
+            float voice = getOutputSidChannel(&sid->channels[i]);
+            if (mix.filterCtrl & (1 << i))
+                fin += voice;
+            else
+                sample += voice;
+        }
+        sidFilterStep(fin, mix.cutoff, mix.resonance, mix.filterSel, &sid->filter, &filtered);
+        sample = (sample + filtered) * mix.masterVol;
+        if (sample < -1.f)
+            sample = -1.f;
+        if (sample > 1.f)
+            sample = 1.f;
+
+        if (bufferType == BUFFER_INT16)
+            ((int16_t *)out)[produced++] = (int16_t)(sample * 32767.f);
+        else
+            ((float *)out)[produced++] = sample;
+    }
+    return produced;
+}
+
+/* The naive model as an engine: checks the reference itself */
+static int32_t runNaive(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                        sid_t *checkpoints)
+{
+    int32_t produced = 0;
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        produced += naiveRender(sid, p->events[i].cycles, &p->events[i].regs, NULL,
+                                sampleAt(out, produced, p->bufferType), maxSamples - produced,
+                                p->bufferType);
+        checkpoints[i] = *sid;
+    }
+    return produced;
+}
+
+/* Random ramps over the program's span: overlapping, starting before
+   and ending inside it, some exponential */
+static uint32_t randomRamps(const program_t *p, sidRamp_t *ramps)
+{
+    uint64_t rng = p->seed;
+    uint64_t span = 1;
+    for (int32_t i = 0; i < p->numEvents; i++)
+        if (p->events[i].cycles > 0)
+            span += (uint64_t)p->events[i].cycles;
+
+    uint32_t n = 1 + rngRange(&rng, VERIFY_MAX_RAMPS);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        sidRamp_t *r = &ramps[i];
+        r->param = (uint8_t)rngRange(&rng, SID_PARAM_COUNT);
+        r->shape = (uint8_t)(rngRange(&rng, 3) == 0 ? SID_RAMP_EXPONENTIAL : SID_RAMP_LINEAR);
+        r->startCycle = rngNext(&rng) % span;
+        r->endCycle = r->startCycle + rngNext(&rng) % span;
+        double range = (r->param <= SID_PARAM_FREQ2) ? 65535.0
+                       : (r->param <= SID_PARAM_PULSE2) ? 4095.0
+                       : (r->param == SID_PARAM_CUTOFF) ? 255.0
+                                                          : 15.0;
+        r->from = 1.0 + (double)rngRange(&rng, 1000) / 1000.0 * range;
+        r->to = 1.0 + (double)rngRange(&rng, 1000) / 1000.0 * range;
+    }
+    return n;
+}
+
+/* ------------------------------------------------------------------
+   Automation with ramps, against the naive model fed the same ramps.
+   The output differs from the unautomated reference, so this engine
+   does its own comparison, sample by sample and state by state.
+   ------------------------------------------------------------------ */
+static int32_t runAutomationRamps(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                                  sid_t *checkpoints)
+{
+    sidRamp_t ramps[VERIFY_MAX_RAMPS];
+    sidAutomation_t a;
+    naiveAutomation_t na;
+    sid_t naive = *sid;
+    char what[160];
+    int32_t produced = 0;
+    int32_t naiveProduced = 0;
+    void *naiveOut = malloc((size_t)maxSamples * sampleBytes(p->bufferType));
+    (void)checkpoints;
+    if (!naiveOut)
+        return -1;
+
+    sidAutomationInit(&a);
+    memset(&na, 0, sizeof(na));
+    na.ramps = ramps;
+    na.numRamps = randomRamps(p, ramps);
+    for (uint32_t i = 0; i < na.numRamps; i++)
+        sidAutomationRamp(&a, (sidParam_t)ramps[i].param, (sidRampShape_t)ramps[i].shape,
+                          ramps[i].startCycle, ramps[i].endCycle, ramps[i].from, ramps[i].to);
+    naiveAutomationEval(&na);
+
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        const sidEvent_t *ev = &p->events[i];
+        produced += bufferSamplesSidAutomated(sid, ev->cycles, &ev->regs, &a,
+                                              sampleAt(out, produced, p->bufferType),
+                                              maxSamples - produced, p->bufferType, true);
+        naiveProduced += naiveRender(&naive, ev->cycles, &ev->regs, &na,
+                                     sampleAt(naiveOut, naiveProduced, p->bufferType),
+                                     maxSamples - naiveProduced, p->bufferType);
+        if (produced != naiveProduced || stateDiffers(&naive, sid, what, sizeof(what)))
+        {
+            printf("    %d ramps: after event %d (sample %d), naive model %s\n", na.numRamps, i,
+                   produced, produced != naiveProduced ? "produced a different count" : what);
+            free(naiveOut);
+            return -1;
+        }
+    }
+
+    size_t size = sampleBytes(p->bufferType);
+    for (int32_t i = 0; i < produced; i++)
+    {
+        if (memcmp((char *)naiveOut + (size_t)i * size, (char *)out + (size_t)i * size, size) == 0)
+            continue;
+        printf("    %d ramps: sample %d: naive %.9g, got %.9g\n", na.numRamps, i,
+               sampleValue(naiveOut, i, p->bufferType), sampleValue(out, i, p->bufferType));
+        free(naiveOut);
+        return -1;
+    }
+    free(naiveOut);
+    return produced;
+}
+
+/* ------------------------------------------------------------------
+   The oversampled filter at 1x: the same arithmetic rearranged, so
+   samples match within VERIFY_OS_TOLERANCE until the filter settings
+   change, where it ramps and the reference jumps.
+   ------------------------------------------------------------------ */
+static int32_t runOversampled(sid_t *sid, const program_t *p, void *out, int32_t maxSamples,
+                              sid_t *checkpoints)
+{
+    sidFilterOs_t f;
+    int32_t produced = 0;
+    sidFilterOsInit(&f, 1);
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        produced += bufferSamplesSidOversampled(sid, p->events[i].cycles, &p->events[i].regs, &f,
+                                                sampleAt(out, produced, p->bufferType),
+                                                maxSamples - produced, p->bufferType, true);
+        checkpoints[i] = *sid;
+    }
+    return produced;
+}
+
+/* As above, each event cut into random calls across filter blocks */
+static int32_t runOversampledSplits(sid_t *sid, const program_t *p, void *out,
+                                    int32_t maxSamples, sid_t *checkpoints)
+{
+    sidFilterOs_t f;
+    uint64_t rng = p->seed;
+    int32_t produced = 0;
+    sidFilterOsInit(&f, 1);
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        int32_t left = p->events[i].cycles;
+        while (left > 0)
+        {
+            int32_t chunk = 1 + (int32_t)rngRange(&rng, (rngNext(&rng) & 1) ? 64 : 8000);
+            if (chunk > left)
+                chunk = left;
+            produced += bufferSamplesSidOversampled(sid, chunk, &p->events[i].regs, &f,
+                                                    sampleAt(out, produced, p->bufferType),
+                                                    maxSamples - produced, p->bufferType, true);
+            left -= chunk;
+        }
+        checkpoints[i] = *sid;
+    }
+    return produced;
+}
+
+/* The last event before the filter settings first change, ignoring
+   events that clock nothing (the filter picks its settings up from
+   the first block it runs) */
+static int32_t osExactUntil(const program_t *p, const sid_t *refCheckpoints)
+{
+    sidMix_t first;
+    bool primed = false;
+    (void)refCheckpoints;
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        sidMix_t mix;
+        if (p->events[i].cycles <= 0)
+            continue;
+        sidMixFromRegs(&p->events[i].regs, &mix);
+        if (!primed)
+        {
+            first = mix;
+            primed = true;
+        }
+        else if (mix.cutoff != first.cutoff || mix.resonance != first.resonance)
+            return i - 1;
+    }
+    return p->numEvents;
+}
+
+static const engine_t engines[] = {
+    {"block splits", runBlockSplits, true, true, NULL, 0.f, false},
+    {"state-only", runStateOnly, true, false, NULL, 0.f, false},
+    {"segmented parallel", runParallel, false, true, NULL, 0.f, false},
+    {"cache miss", runCacheMiss, false, true, NULL, 0.f, false},
+    {"cache hit", runCacheHit, false, true, NULL, 0.f, false},
+    {"analysis tap", runAnalysis, true, true, NULL, 0.f, false},
+    {"stems tap", runStems, true, true, NULL, 0.f, false},
+    {"automation, no ramps", runAutomation, true, true, NULL, 0.f, false},
+    {"automation, ramps vs naive", runAutomationRamps, false, false, NULL, 0.f, true},
+    {"real-time blocks", runRt, true, true, rtExactUntil, 0.f, false},
+    {"C++ render<>", runCpp, true, true, NULL, 0.f, false},
+    {"C++ render<>, 2 chips", runCppLockstep, true, true, NULL, 0.f, false},
+    {"naive per-cycle model", runNaive, true, true, NULL, 0.f, false},
+    {"oversampled filter 1x", runOversampled, true, true, osExactUntil, VERIFY_OS_TOLERANCE, false},
+    {"oversampled filter 1x, splits", runOversampledSplits, true, true, osExactUntil,
+     VERIFY_OS_TOLERANCE, false},
+};
+#define NUM_ENGINES (int)(sizeof(engines) / sizeof(engines[0]))
+
+/* ------------------------------------------------------------------
+   Comparison and reporting
+   ------------------------------------------------------------------ */
+
+/* First differing state field, described in 'what'; false if none */
+static bool stateDiffers(const sid_t *ref, const sid_t *alt, char *what, size_t size)
+{
+#define CHECK(field, fmt, cast)                                                  \
+    if (memcmp(&ref->field, &alt->field, sizeof(ref->field)) != 0)               \
+    {                                                                            \
+        snprintf(what, size, "%s: ref " fmt ", got " fmt, #field,                \
+                 (cast)ref->field, (cast)alt->field);                            \
+        return true;                                                             \
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        const sidChannel_t *r = &ref->channels[c];
+        const sidChannel_t *a = &alt->channels[c];
+#define CHECK_CH(field, fmt)                                                     \
+    if (r->field != a->field)                                                    \
+    {                                                                            \
+        snprintf(what, size, "channel %d %s: ref " fmt ", got " fmt, c, #field,  \
+                 (unsigned)r->field, (unsigned)a->field);                        \
+        return true;                                                             \
+    }
+        CHECK_CH(accumulator, "0x%06x")
+        CHECK_CH(noiseGenerator, "0x%06x")
+        CHECK_CH(adsrCounter, "%u")
+        CHECK_CH(adsrExpCounter, "%u")
+        CHECK_CH(volumeLevel, "%u")
+        CHECK_CH(state, "%u")
+        CHECK_CH(doSync, "%u")
+        CHECK_CH(frequency, "0x%04x")
+        CHECK_CH(pulse, "0x%03x")
+        CHECK_CH(waveform, "0x%02x")
+        CHECK_CH(ad, "0x%02x")
+        CHECK_CH(sr, "0x%02x")
+#undef CHECK_CH
+    }
+    CHECK(filter.low, "%.9g", double)
+    CHECK(filter.band, "%.9g", double)
+    CHECK(cycleAccumulator, "0x%016llx", unsigned long long)
+    CHECK(cyclesPerSample, "0x%016llx", unsigned long long)
+#undef CHECK
+    return false;
+}
+
+static double sampleValue(const void *out, int32_t i, int bufferType)
+{
+    if (bufferType == BUFFER_INT16)
+        return ((const int16_t *)out)[i];
+    return ((const float *)out)[i];
+}
+
+static void printEvent(const program_t *p, int32_t e)
+{
+    const sidEvent_t *ev = &p->events[e];
+    const sidRegs_t *r = &ev->regs;
+    printf("    event %d: cycles %d\n", e, ev->cycles);
+    printf("      v0 freq %04x pw %03x wf %02x ad %02x sr %02x\n",
+           (uint16_t)r->freq0, (uint16_t)r->pulse0, (uint8_t)r->waveform0, (uint8_t)r->ad0, (uint8_t)r->sr0);
+    printf("      v1 freq %04x pw %03x wf %02x ad %02x sr %02x\n",
+           (uint16_t)r->freq1, (uint16_t)r->pulse1, (uint8_t)r->waveform1, (uint8_t)r->ad1, (uint8_t)r->sr1);
+    printf("      v2 freq %04x pw %03x wf %02x ad %02x sr %02x\n",
+           (uint16_t)r->freq2, (uint16_t)r->pulse2, (uint8_t)r->waveform2, (uint8_t)r->ad2, (uint8_t)r->sr2);
+    printf("      cutoff %02x filterCtrl %02x volume %02x\n",
+           (uint8_t)r->cutoff, (uint8_t)r->filterCtrl, (uint8_t)r->volume);
+}
+
+/* The event whose render produced sample 'index' */
+static int32_t eventOfSample(const int32_t *eventEnd, int32_t numEvents, int32_t index)
+{
+    for (int32_t e = 0; e < numEvents; e++)
+        if (index < eventEnd[e])
+            return e;
+    return numEvents - 1;
+}
+
+static void printFailure(const engine_t *engine, const program_t *p, uint64_t baseSeed)
+{
+    printf("FAIL %s: %s (seed 0x%llx, %d Hz, %s)\n", engine->name, p->name,
+           (unsigned long long)baseSeed, p->sampleRate,
+           p->bufferType == BUFFER_INT16 ? "int16" : "float");
+}
+
+/* Run one engine against the reference results; true if it matches */
+static bool verifyEngine(const engine_t *engine, const program_t *p, uint64_t baseSeed,
+                         const void *refOut, int32_t refSamples, const sid_t *refCheckpoints,
+                         const int32_t *eventEnd, int32_t exactUntil, void *out,
+                         int32_t maxSamples, sid_t *checkpoints)
+{
+    sid_t sid;
+    char what[160];
+    sidInit(&sid, p->sampleRate);
+    memset(out, 0, (size_t)maxSamples * sampleBytes(p->bufferType));
+
+    int32_t produced = engine->run(&sid, p, out, maxSamples,
+                                   engine->hasCheckpoints ? checkpoints : NULL);
+    if (produced < 0)
+    {
+        printFailure(engine, p, baseSeed);
+        return false;
+    }
+
+    if (produced != refSamples)
+    {
+        printFailure(engine, p, baseSeed);
+        printf("    produced %d samples, reference %d\n", produced, refSamples);
+        return false;
+    }
+
+    if (engine->ownReference)
+        return true;
+
+    /* Samples, through the end of the last exact event. With a
+       tolerance, int16 samples may also differ by the truncation. */
+    int32_t exactSamples = (exactUntil < p->numEvents) ? eventEnd[exactUntil] : produced;
+    double tolerance = engine->tolerance;
+    if (p->bufferType == BUFFER_INT16 && tolerance > 0.0)
+        tolerance = tolerance * 32767.0 + 1.0;
+    if (engine->hasOutput)
+    {
+        size_t size = sampleBytes(p->bufferType);
+        for (int32_t i = 0; i < exactSamples; i++)
+        {
+            if (tolerance > 0.0)
+            {
+                if (fabs(sampleValue(refOut, i, p->bufferType) - sampleValue(out, i, p->bufferType)) <= tolerance)
+                    continue;
+            }
+            else if (memcmp((const char *)refOut + (size_t)i * size, (char *)out + (size_t)i * size, size) == 0)
+                continue;
+
+            int32_t e = eventOfSample(eventEnd, p->numEvents, i);
+            printFailure(engine, p, baseSeed);
+            printf("    first sample divergence at sample %d (event %d)\n", i, e);
+            for (int32_t j = i - VERIFY_CONTEXT; j <= i + VERIFY_CONTEXT; j++)
+                if (j >= 0 && j < produced)
+                    printf("    %c %8d  ref %12.9g  got %12.9g\n", j == i ? '>' : ' ', j,
+                           sampleValue(refOut, j, p->bufferType), sampleValue(out, j, p->bufferType));
+            printEvent(p, e);
+            return false;
+        }
+    }
+
+    /* State at the checkpoints, or at the end */
+    if (engine->hasCheckpoints)
+    {
+        for (int32_t e = 0; e < exactUntil; e++)
+        {
+            if (engine->tolerance > 0.f)
+                checkpoints[e].filter = refCheckpoints[e].filter;
+            if (!stateDiffers(&refCheckpoints[e], &checkpoints[e], what, sizeof(what)))
+                continue;
+            printFailure(engine, p, baseSeed);
+            printf("    state divergence after event %d (sample %d): %s\n", e, eventEnd[e], what);
+            printEvent(p, e);
+            return false;
+        }
+    }
+    else if (p->numEvents > 0 && exactUntil == p->numEvents &&
+             stateDiffers(&refCheckpoints[p->numEvents - 1], &sid, what, sizeof(what)))
+    {
+        printFailure(engine, p, baseSeed);
+        printf("    end state divergence: %s\n", what);
+        return false;
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------------
+   Programs
+   ------------------------------------------------------------------ */
+static const int32_t sampleRates[] = {44100, 48000, 22050, 96000, 8000};
+#define NUM_RATES (int)(sizeof(sampleRates) / sizeof(sampleRates[0]))
+
+static const uint8_t waveforms[] = {
+    0x10, 0x20, 0x40, 0x80, 0x50, 0x60, 0x70, 0x30,
+    0x12, 0x14, 0x16, 0x22, 0x42, 0x44, 0x08, 0x00};
+#define NUM_WAVEFORMS (int)(sizeof(waveforms) / sizeof(waveforms[0]))
+
+static void randomVoice(uint64_t *rng, int16_t *freq, int16_t *pulse, int8_t *waveform,
+                        int8_t *ad, int8_t *sr)
+{
+    *freq = (int16_t)(rngRange(rng, 8) == 0 ? 0 : rngNext(rng));
+    *pulse = (int16_t)(rngNext(rng) & 0x0fff);
+    *waveform = (int8_t)(waveforms[rngRange(rng, NUM_WAVEFORMS)] | (rngNext(rng) & 1));
+    *ad = (int8_t)rngNext(rng);
+    *sr = (int8_t)rngNext(rng);
+}
+
+static void randomProgram(program_t *p, uint64_t *rng, int index)
+{
+    p->numEvents = 1 + (int32_t)rngRange(rng, VERIFY_MAX_EVENTS);
+    p->sampleRate = sampleRates[rngRange(rng, NUM_RATES)];
+    p->bufferType = (rngNext(rng) & 1) ? BUFFER_INT16 : BUFFER_FLOAT;
+    p->seed = rngNext(rng) | 1;
+    snprintf(p->name, sizeof(p->name), "random #%d", index);
+
+    /* A third never route a voice into the filter, as many tunes
+       don't; only those are segmented by sidRenderEventsPooled */
+    bool filtered = rngRange(rng, 3) != 0;
+
+    sidRegs_t regs;
+    memset(&regs, 0, sizeof(regs));
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        /* Change a few registers per event, as a player would */
+        switch (rngRange(rng, 5))
+        {
+        case 0:
+            randomVoice(rng, &regs.freq0, &regs.pulse0, &regs.waveform0, &regs.ad0, &regs.sr0);
+            break;
+        case 1:
+            randomVoice(rng, &regs.freq1, &regs.pulse1, &regs.waveform1, &regs.ad1, &regs.sr1);
+            break;
+        case 2:
+            randomVoice(rng, &regs.freq2, &regs.pulse2, &regs.waveform2, &regs.ad2, &regs.sr2);
+            break;
+        case 3:
+            regs.cutoff = (int8_t)rngNext(rng);
+            regs.filterCtrl = (int8_t)(rngRange(rng, 3) == 0 ? 0 : rngNext(rng));
+            if (!filtered)
+                regs.filterCtrl &= (int8_t)0xf0;
+            regs.volume = (int8_t)rngNext(rng);
+            break;
+        default:
+            /* Toggle one gate */
+            if (rngNext(rng) & 1)
+                regs.waveform0 ^= 1;
+            else
+                regs.waveform2 ^= 1;
+            break;
+        }
+
+        int32_t cycles;
+        switch (rngRange(rng, 10))
+        {
+        case 0:
+            cycles = (int32_t)rngRange(rng, 64); /* including 0 */
+            break;
+        case 1:
+        case 2:
+        case 3:
+            cycles = 64 + (int32_t)rngRange(rng, 5000);
+            break;
+        default:
+            cycles = 5000 + (int32_t)rngRange(rng, 60000);
+            break;
+        }
+        p->events[i].regs = regs;
+        p->events[i].cycles = cycles;
+    }
+}
+
+/* The demo's C major scale over a drone and noise, with the cutoff
+   stepped per note */
+static void corpusScale(program_t *p)
+{
+    static const float scale[8] = {261.63f, 293.66f, 329.63f, 349.23f,
+                                   392.00f, 440.00f, 493.88f, 523.25f};
+    sidRegs_t regs;
+    memset(&regs, 0, sizeof(regs));
+    regs.waveform0 = 0x41;
+    regs.ad0 = 0x11;
+    regs.sr0 = (int8_t)0xf0;
+    regs.pulse0 = 0x0400;
+    regs.waveform1 = 0x11;
+    regs.ad1 = 0x22;
+    regs.sr1 = (int8_t)0xf0;
+    regs.freq1 = (int16_t)(440.f * 17.f + 0.5f);
+    regs.waveform2 = (int8_t)0x81;
+    regs.ad2 = 0x33;
+    regs.sr2 = (int8_t)0xf0;
+    regs.freq2 = (int16_t)(5000.f * 17.f + 0.5f);
+    regs.filterCtrl = 0x07;
+    regs.volume = 0x1f;
+
+    snprintf(p->name, sizeof(p->name), "corpus: scale");
+    p->numEvents = 16;
+    for (int32_t i = 0; i < 16; i++)
+    {
+        regs.freq0 = (int16_t)(scale[i % 8] * 17.f + 0.5f);
+        regs.cutoff = (int8_t)(i * 16);
+        p->events[i].regs = regs;
+        p->events[i].cycles = 11172; /* ~1/2 s at 44.1 kHz, in 4 events per note */
+    }
+}
+
+/* The simple demo: a square wave rendered in small fixed steps */
+static void corpusSimple(program_t *p)
+{
+    sidRegs_t regs;
+    memset(&regs, 0, sizeof(regs));
+    regs.freq0 = (int16_t)(440.f * 17.f + 0.5f);
+    regs.pulse0 = 0x0400;
+    regs.waveform0 = 0x41;
+    regs.ad0 = 0x1d;
+    regs.sr0 = 0x20;
+    regs.volume = 0x0f;
+
+    snprintf(p->name, sizeof(p->name), "corpus: simple");
+    p->numEvents = 64;
+    for (int32_t i = 0; i < 64; i++)
+    {
+        p->events[i].regs = regs;
+        p->events[i].cycles = 22 * 400;
+    }
+}
+
+/* Hard-sync and ring-mod leads, with gate retriggers */
+static void corpusSync(program_t *p)
+{
+    sidRegs_t regs;
+    memset(&regs, 0, sizeof(regs));
+    regs.freq0 = 0x0c00;
+    regs.freq1 = 0x1d45;
+    regs.freq2 = 0x0461;
+    regs.waveform1 = 0x23; /* saw + sync + gate */
+    regs.waveform2 = 0x15; /* triangle + ring + gate */
+    regs.waveform0 = 0x11;
+    regs.ad0 = regs.ad1 = regs.ad2 = 0x08;
+    regs.sr0 = regs.sr1 = regs.sr2 = (int8_t)0xc6;
+    regs.volume = 0x0f;
+
+    snprintf(p->name, sizeof(p->name), "corpus: sync/ring");
+    p->numEvents = 48;
+    for (int32_t i = 0; i < 48; i++)
+    {
+        regs.freq1 = (int16_t)(0x1d45 + i * 0x0123);
+        if (i % 8 == 7)
+            regs.waveform1 ^= 1;
+        p->events[i].regs = regs;
+        p->events[i].cycles = 4000 + (i % 5) * 1711;
+    }
+}
+
+/* Noise drums with test-bit hard restarts between hits */
+static void corpusDrums(program_t *p)
+{
+    sidRegs_t regs;
+    memset(&regs, 0, sizeof(regs));
+    regs.ad2 = 0x00;
+    regs.sr2 = (int8_t)0xa9;
+    regs.volume = 0x0f;
+
+    snprintf(p->name, sizeof(p->name), "corpus: drums");
+    p->numEvents = 0;
+    for (int32_t hit = 0; hit < 16; hit++)
+    {
+        regs.waveform2 = 0x09; /* test + gate */
+        regs.freq2 = (int16_t)(0x2000 + hit * 0x0800);
+        p->events[p->numEvents].regs = regs;
+        p->events[p->numEvents++].cycles = 19;
+
+        regs.waveform2 = (int8_t)0x81;
+        p->events[p->numEvents].regs = regs;
+        p->events[p->numEvents++].cycles = 3000;
+
+        regs.waveform2 = (int8_t)0x80;
+        p->events[p->numEvents].regs = regs;
+        p->events[p->numEvents++].cycles = 9000;
+    }
+}
+
+/* Resonant filter sweeps through each mode, all voices routed */
+static void corpusFilter(program_t *p)
+{
+    sidRegs_t regs;
+    memset(&regs, 0, sizeof(regs));
+    regs.freq0 = 0x0800;
+    regs.freq1 = 0x0804;
+    regs.freq2 = 0x1000;
+    regs.pulse0 = regs.pulse1 = 0x0600;
+    regs.waveform0 = 0x41;
+    regs.waveform1 = 0x21;
+    regs.waveform2 = 0x11;
+    regs.sr0 = regs.sr1 = regs.sr2 = (int8_t)0xf0;
+    regs.filterCtrl = (int8_t)0xf7;
+
+    snprintf(p->name, sizeof(p->name), "corpus: filter sweep");
+    p->numEvents = 64;
+    for (int32_t i = 0; i < 64; i++)
+    {
+        regs.cutoff = (int8_t)(i * 4);
+        regs.volume = (int8_t)(((1 + i / 16 % 7) << 4) | 0x0f);
+        p->events[i].regs = regs;
+        p->events[i].cycles = 2500;
+    }
+}
+
+static void (*const corpus[])(program_t *) = {corpusScale, corpusSimple, corpusSync,
+                                              corpusDrums, corpusFilter};
+#define NUM_CORPUS (int)(sizeof(corpus) / sizeof(corpus[0]))
+
+/* A register log file; returns false if it can't be read */
+static bool loadProgram(program_t *p, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    int32_t row[SID_EVENT_COLUMNS];
+    int32_t n = 0;
+    while (fread(row, sizeof(row), 1, f) == 1)
+    {
+        sidEvent_t *events = (sidEvent_t *)realloc(p->events, (size_t)(n + 1) * sizeof(sidEvent_t));
+        if (!events)
+            break;
+        p->events = events;
+        sidEventFromRow(&p->events[n], row);
+        n++;
+    }
+    fclose(f);
+    p->numEvents = n;
+    snprintf(p->name, sizeof(p->name), "log: %.58s", path);
+    return true;
+}
+
+/* ------------------------------------------------------------------
+   Driver
+   ------------------------------------------------------------------ */
+static int32_t maxSamplesFor(const program_t *p)
+{
+    sid_t sid;
+    int64_t cycles = 0;
+    sidInit(&sid, p->sampleRate);
+    for (int32_t i = 0; i < p->numEvents; i++)
+        if (p->events[i].cycles > 0)
+            cycles += p->events[i].cycles;
+    int64_t perSample = (int64_t)(sid.cyclesPerSample >> SID_PHASE_BITS);
+    if (perSample < 1)
+        perSample = 1;
+    return (int32_t)(cycles / perSample + p->numEvents + 16);
+}
+
+/* Engine runs compared only up to where the engine stops being exact */
+static int partial;
+
+/* Verify one program against every engine; returns the failure count */
+static int verifyProgram(const program_t *p, uint64_t baseSeed)
+{
+    int32_t maxSamples = maxSamplesFor(p);
+    size_t bytes = (size_t)maxSamples * sampleBytes(p->bufferType);
+    int32_t checkpointCount = p->numEvents > 0 ? p->numEvents : 1;
+    void *refOut = malloc(bytes);
+    void *out = malloc(bytes);
+    int32_t *eventEnd = (int32_t *)malloc((size_t)checkpointCount * sizeof(int32_t));
+    sid_t *refCheckpoints = (sid_t *)aligned_alloc(SID_ALIGN, (size_t)checkpointCount * sizeof(sid_t));
+    sid_t *checkpoints = (sid_t *)aligned_alloc(SID_ALIGN, (size_t)checkpointCount * sizeof(sid_t));
+    int failures = 0;
+
+    if (!refOut || !out || !eventEnd || !refCheckpoints || !checkpoints)
+    {
+        printf("FAIL %s: out of memory\n", p->name);
+        failures = 1;
+        goto done;
+    }
+
+    /* Reference, tracking where each event's samples end */
+    sid_t sid;
+    sidInit(&sid, p->sampleRate);
+    int32_t refSamples = 0;
+    for (int32_t i = 0; i < p->numEvents; i++)
+    {
+        program_t one = *p;
+        one.events = &p->events[i];
+        one.numEvents = 1;
+        refSamples += runReference(&sid, &one, sampleAt(refOut, refSamples, p->bufferType),
+                                   maxSamples - refSamples, &refCheckpoints[i]);
+        eventEnd[i] = refSamples;
+    }
+    if (p->numEvents == 0)
+        refCheckpoints[0] = sid;
+
+    for (int e = 0; e < NUM_ENGINES; e++)
+    {
+        int32_t exactUntil = p->numEvents;
+        if (engines[e].exactUntil)
+            exactUntil = engines[e].exactUntil(p, refCheckpoints);
+        if (exactUntil < p->numEvents)
+            partial++;
+        if (!verifyEngine(&engines[e], p, baseSeed, refOut, refSamples, refCheckpoints,
+                          eventEnd, exactUntil, out, maxSamples, checkpoints))
+            failures++;
+    }
+
+done:
+    free(refOut);
+    free(out);
+    free(eventEnd);
+    free(refCheckpoints);
+    free(checkpoints);
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    int numPrograms = VERIFY_DEFAULT_PROGRAMS;
+    uint64_t seed = VERIFY_DEFAULT_SEED;
+    int failures = 0;
+    int programs = 0;
+    program_t p;
+
+    memset(&p, 0, sizeof(p));
+    sidCacheInit(&cache, (size_t)64 << 20);
+    if (!sidSegmentPoolInit(&pool, VERIFY_THREADS))
+    {
+        printf("can't start %d render threads\n", VERIFY_THREADS);
+        return 1;
+    }
+
+    /* Built-in corpus and random programs share one event array */
+    static sidEvent_t events[VERIFY_MAX_EVENTS];
+    p.events = events;
+
+    int argi = 1;
+    for (; argi < argc; argi++)
+    {
+        if (strcmp(argv[argi], "-n") == 0 && argi + 1 < argc)
+            numPrograms = atoi(argv[++argi]);
+        else if (strcmp(argv[argi], "-s") == 0 && argi + 1 < argc)
+            seed = strtoull(argv[++argi], NULL, 0);
+        else
+            break;
+    }
+
+    for (int c = 0; c < NUM_CORPUS; c++)
+    {
+        corpus[c](&p);
+        for (int r = 0; r < 2; r++)
+        {
+            p.sampleRate = r ? 48000 : 44100;
+            p.bufferType = r ? BUFFER_FLOAT : BUFFER_INT16;
+            p.seed = seed + (uint64_t)c * 2 + (uint64_t)r + 1;
+            failures += verifyProgram(&p, seed);
+            programs++;
+        }
+    }
+
+    uint64_t rng = seed ? seed : 1;
+    for (int i = 0; i < numPrograms; i++)
+    {
+        randomProgram(&p, &rng, i);
+        failures += verifyProgram(&p, seed);
+        programs++;
+    }
+
+    /* Register logs from the command line */
+    for (; argi < argc; argi++)
+    {
+        program_t log;
+        memset(&log, 0, sizeof(log));
+        if (!loadProgram(&log, argv[argi]))
+        {
+            printf("FAIL %s: can't read\n", argv[argi]);
+            failures++;
+            continue;
+        }
+        for (int r = 0; r < 2; r++)
+        {
+            log.sampleRate = 44100;
+            log.bufferType = r ? BUFFER_FLOAT : BUFFER_INT16;
+            log.seed = seed + 1;
+            failures += verifyProgram(&log, seed);
+            programs++;
+        }
+        free(log.events);
+    }
+
+    sidSegmentPoolDestroy(&pool);
+    sidCacheDestroy(&cache);
+    printf("%d programs x %d engines: %d divergence%s", programs, NUM_ENGINES, failures,
+           failures == 1 ? "" : "s");
+    if (partial)
+        printf(" (%d run%s compared up to a denormal flush or filter ramp)", partial,
+               partial == 1 ? "" : "s");
+    printf("\n");
+    return failures ? 1 : 0;
+}
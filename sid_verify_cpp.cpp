@@ -0,0 +1,90 @@
+/* ------------------------------------------------------------------
+   sid_verify engines for the C++ layer (simple_sid.hpp), called from
+   sid_verify.c. Both render a program event by event through
+   sid::render<>: one chip (the sidRenderMix path), and two chips in
+   lockstep (the templated frame loop), whose first channel is checked
+   against the reference and whose second must match the first.
+   ------------------------------------------------------------------ */
+#include <cstdio>
+#include <vector>
+#include "simple_sid.hpp"
+
+namespace
+{
+
+template <typename OutFormat>
+int32_t renderSingle(sid_t *state, int32_t sampleRate, const sidEvent_t *events, int32_t numEvents,
+                     void *out, int32_t maxSamples, sid_t *checkpoints)
+{
+    sid::Chip chip(sampleRate);
+    *chip.get() = *state;
+    OutFormat *dst = static_cast<OutFormat *>(out);
+    int32_t produced = 0;
+    for (int32_t i = 0; i < numEvents; i++)
+    {
+        std::span<OutFormat> rest(dst + produced, (std::size_t)(maxSamples - produced));
+        produced += (int32_t)chip.render<OutFormat>(events[i].cycles, events[i].regs, rest);
+        checkpoints[i] = *chip.get();
+    }
+    *state = *chip.get();
+    return produced;
+}
+
+template <typename OutFormat>
+int32_t renderLockstep(sid_t *state, int32_t sampleRate, const sidEvent_t *events, int32_t numEvents,
+                       void *out, int32_t maxSamples, sid_t *checkpoints)
+{
+    std::array<sid::Chip, 2> chips{sid::Chip(sampleRate), sid::Chip(sampleRate)};
+    for (sid::Chip &chip : chips)
+        *chip.get() = *state;
+
+    std::vector<OutFormat> frames((std::size_t)maxSamples * 2);
+    OutFormat *dst = static_cast<OutFormat *>(out);
+    int32_t produced = 0;
+    for (int32_t i = 0; i < numEvents; i++)
+    {
+        const std::array<sidRegs_t, 2> regs{events[i].regs, events[i].regs};
+        std::span<OutFormat> rest(frames.data() + (std::size_t)produced * 2,
+                                  (std::size_t)(maxSamples - produced) * 2);
+        produced += (int32_t)sid::render<OutFormat, sid::Mode::Replace, 2>(
+            std::span<sid::Chip, 2>(chips), events[i].cycles, std::span<const sidRegs_t, 2>(regs), rest);
+        checkpoints[i] = *chips[0].get();
+    }
+
+    for (int32_t s = 0; s < produced; s++)
+    {
+        if (memcmp(&frames[(std::size_t)s * 2], &frames[(std::size_t)s * 2 + 1], sizeof(OutFormat)) != 0)
+        {
+            std::printf("    chips differ at frame %d\n", s);
+            return -1;
+        }
+        dst[s] = frames[(std::size_t)s * 2];
+    }
+    if (memcmp(chips[0].get(), chips[1].get(), sizeof(sid_t)) != 0)
+    {
+        std::printf("    chip states differ\n");
+        return -1;
+    }
+    *state = *chips[0].get();
+    return produced;
+}
+
+} // namespace
+
+extern "C" int32_t verifyCppRender(sid_t *sid, int32_t sampleRate, const sidEvent_t *events,
+                                   int32_t numEvents, void *out, int32_t maxSamples, int bufferType,
+                                   sid_t *checkpoints)
+{
+    if (bufferType == BUFFER_INT16)
+        return renderSingle<int16_t>(sid, sampleRate, events, numEvents, out, maxSamples, checkpoints);
+    return renderSingle<float>(sid, sampleRate, events, numEvents, out, maxSamples, checkpoints);
+}
+
+extern "C" int32_t verifyCppRenderLockstep(sid_t *sid, int32_t sampleRate, const sidEvent_t *events,
+                                           int32_t numEvents, void *out, int32_t maxSamples,
+                                           int bufferType, sid_t *checkpoints)
+{
+    if (bufferType == BUFFER_INT16)
+        return renderLockstep<int16_t>(sid, sampleRate, events, numEvents, out, maxSamples, checkpoints);
+    return renderLockstep<float>(sid, sampleRate, events, numEvents, out, maxSamples, checkpoints);
+}
@@ -1,26 +1,30 @@
 #include "simple_sid.h"
+#include "sid_kernel.h"
+#include "sid_analysis.h"
+#include "sid_automation.h"
+#include "sid_stems.h"
 
 /* ------------------------------------------------------------------
    Internal tables for ADSR increments & sustain levels
    ------------------------------------------------------------------ */
-static unsigned short adsrRateTable[] = {
-    9, 32, 63, 95, 149, 220, 267, 313,
-    392, 977, 1954, 3126, 3907, 11720, 19532, 31251};
+static const unsigned short adsrRateTable[] = {SID_ADSR_RATES};
 
-static uint8_t sustainLevels[] = {
-    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
-    0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+static const uint8_t sustainLevels[] = {SID_SUSTAIN_LEVELS};
 
-static uint8_t expTargetTable[] = {
+/* Indexed by volumeLevel < 0x5d; unlisted tail entries are 0, which
+   the envelope treats the same as 1. */
+static const uint8_t expTargetTable[0x5d] = {
     1, 30, 30, 30, 30, 30, 16, 16, 16, 16, 16, 16, 16, 16, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 4, 4, 4, 4,
     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
     2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2};
 
 /* ------------------------------------------------------------------
-   Channel init
+   Channel init. 'index' is the channel's slot in sid_t.channels[]
+   (0..2); the sync/ring-mod neighbours are found from it.
    ------------------------------------------------------------------ */
-void sidChannelInit(sidChannel_t *ch)
+void sidChannelInit(sidChannel_t *ch, uint8_t index)
 {
+    assert(index < 3);
     ch->frequency = 0;
     ch->ad = 0;
     ch->sr = 0;
@@ -33,8 +37,7 @@ void sidChannelInit(sidChannel_t *ch)
     ch->adsrCounter = 0;
     ch->adsrExpCounter = 0;
     ch->volumeLevel = 0;
-    ch->syncTarget = NULL;
-    ch->syncSource = NULL;
+    ch->index = index;
 }
 
 /* ------------------------------------------------------------------
@@ -44,22 +47,19 @@ void sidChannelInit(sidChannel_t *ch)
 void sidInit(sid_t *sid, int32_t sampleRate)
 {
     int i;
-    sid->cyclesPerSample = (63.f * 312.f * 50.f) / (float)sampleRate;
-    sid->cycleAccumulator = 0.f;
+    assert(sampleRate > 0 && sampleRate <= SID_CLOCK_PAL);
+    /* Clear padding too, so chips can be compared/hashed bytewise */
+    memset(sid, 0, sizeof(*sid));
+    sid->cyclesPerSample = ((uint64_t)SID_CLOCK_PAL << SID_PHASE_BITS) /
+                           (uint64_t)sampleRate;
+    sid->cycleAccumulator = 0;
     sid->filter.low = 0.f;
     sid->filter.band = 0.f;
 
     for (i = 0; i < 3; i++)
-        sidChannelInit(&sid->channels[i]);
-
-    /* Wire up channel sync pointers */
-    sid->channels[0].syncTarget = &sid->channels[1];
-    sid->channels[1].syncTarget = &sid->channels[2];
-    sid->channels[2].syncTarget = &sid->channels[0];
-
-    sid->channels[0].syncSource = &sid->channels[2];
-    sid->channels[1].syncSource = &sid->channels[0];
-    sid->channels[2].syncSource = &sid->channels[1];
+    {
+        sidChannelInit(&sid->channels[i], (uint8_t)i);
+    }
 }
 
 /* ------------------------------------------------------------------
@@ -69,7 +69,7 @@ unsigned triangleSidChannel(sidChannel_t *ch)
 {
     unsigned t = ch->accumulator;
     if (ch->waveform & 0x04) /* ringmod bit? */
-        t ^= ch->syncSource->accumulator;
+        t ^= sidSyncSource(ch)->accumulator;
 
     if (t >= 0x800000)
         t = (ch->accumulator ^ 0xffffff);
@@ -94,9 +94,9 @@ unsigned noiseSidChannel(sidChannel_t *ch)
 }
 
 /* ------------------------------------------------------------------
-   Clock a channel's accumulator + ADSR for 'cycles'
+   Clock a channel's gate + ADSR for 'cycles'
    ------------------------------------------------------------------ */
-void clockSidChannel(sidChannel_t *ch, int cycles)
+static void clockEnvelope(sidChannel_t *ch, int cycles)
 {
     /* Gate bit => Attack; else Release */
     if (ch->waveform & 0x01)
@@ -134,6 +134,30 @@ void clockSidChannel(sidChannel_t *ch, int cycles)
                              : (0x8000 + rate - ch->adsrCounter);
             int stepNow = (adsrCycles < needed) ? adsrCycles : needed;
 
+            /* Sustaining, or released to silence: the level can't move,
+               so skip straight over all the remaining rate periods. */
+            if (adsrCycles > needed &&
+                ((ch->state == DECAY && ch->volumeLevel <= sustainLevels[ch->sr >> 4]) ||
+                 (ch->state == RELEASE && ch->volumeLevel == 0)))
+            {
+                int periods = (adsrCycles - needed) / rate;
+                if (ch->state == DECAY)
+                {
+                    uint8_t expTarget = (ch->volumeLevel < 0x5d)
+                                            ? expTargetTable[ch->volumeLevel]
+                                            : 1;
+                    if (expTarget == 0)
+                        expTarget = 1;
+                    unsigned first = (ch->adsrExpCounter + 1u >= expTarget) ? 0 : ch->adsrExpCounter + 1u;
+                    ch->adsrExpCounter = (uint8_t)((first + (unsigned)periods) % expTarget);
+                }
+                ch->adsrCounter = 0;
+                adsrCycles -= needed + periods * rate;
+                if (adsrCycles == 0)
+                    break;
+                continue;
+            }
+
             ch->adsrCounter = (ch->adsrCounter + stepNow) & 0x7fff;
 
             if (ch->adsrCounter == rate)
@@ -182,6 +206,48 @@ void clockSidChannel(sidChannel_t *ch, int cycles)
             adsrCycles -= stepNow;
         }
     }
+}
+
+/* Cycle count meaning "no edge within the span being clocked" */
+#define SID_NO_EDGE INT32_MAX
+
+/* ------------------------------------------------------------------
+   Cycles until the rising edge of the accumulator bit 'half' (bit 23
+   for sync, bit 19 for noise), with 'pos' the accumulator masked to
+   2*half. SID_NO_EDGE if it is not reached within 'left' cycles, which
+   saves the divide on the common no-edge path.
+   ------------------------------------------------------------------ */
+static int cyclesToEdge(unsigned pos, unsigned half, uint16_t frequency, int left)
+{
+    if (frequency == 0)
+        return SID_NO_EDGE;
+    unsigned dist = ((pos < half) ? half : 3 * half) - pos;
+    if ((uint64_t)frequency * (unsigned)left < dist)
+        return SID_NO_EDGE;
+    return (int)((dist + frequency - 1) / frequency);
+}
+
+/* Shift the noise LFSR once (on a bit-19 rising edge) */
+static void clockNoise(sidChannel_t *ch)
+{
+    unsigned tmp = ch->noiseGenerator;
+    unsigned step = (tmp & 0x400000) ^
+                    ((tmp & 0x20000) << 5);
+    tmp <<= 1;
+    if (step)
+        tmp |= 1;
+    ch->noiseGenerator = tmp & 0x7fffff;
+}
+
+/* ------------------------------------------------------------------
+   Clock a channel's accumulator + ADSR for 'cycles'
+   Stand-alone: sets doSync if the accumulator MSB rose while its sync
+   target has the sync bit, but leaves resetting the target to the
+   caller. sidClockChannels() clocks a whole chip with exact sync.
+   ------------------------------------------------------------------ */
+void clockSidChannel(sidChannel_t *ch, int cycles)
+{
+    clockEnvelope(ch, cycles);
 
     /* Test bit => zero accumulator */
     if (ch->waveform & 0x08)
@@ -195,87 +261,135 @@ void clockSidChannel(sidChannel_t *ch, int cycles)
         return;
 
     /* If no noise (0x80) and syncTarget has no sync bit (0x02), do fast update */
-    if (((ch->waveform & 0x80) == 0) && ((ch->syncTarget->waveform & 0x02) == 0))
+    bool sync = (sidSyncTarget(ch)->waveform & 0x02) != 0;
+    if (((ch->waveform & 0x80) == 0) && !sync)
     {
         unsigned inc = ch->frequency * (unsigned)cycles;
         ch->accumulator = (ch->accumulator + inc) & 0xffffff;
         return;
     }
 
-    /* Otherwise, step carefully for noise or sync triggers */
+    /* Otherwise, step from edge to edge for noise or sync triggers */
+    ch->doSync = false;
+    int left = cycles;
+    while (left > 0)
     {
-        int left = cycles;
-        while (left > 0)
-        {
-            int stepNow = left;
-            unsigned lastAcc = ch->accumulator;
+        int toNoise = (ch->waveform & 0x80)
+                          ? cyclesToEdge(ch->accumulator & 0xfffff, 0x80000, ch->frequency, left)
+                          : SID_NO_EDGE;
+        int toSync = sync ? cyclesToEdge(ch->accumulator, 0x800000, ch->frequency, left)
+                          : SID_NO_EDGE;
+        int stepNow = left;
+        if (toNoise < stepNow)
+            stepNow = toNoise;
+        if (toSync < stepNow)
+            stepNow = toSync;
+
+        ch->accumulator = (ch->accumulator + ch->frequency * (unsigned)stepNow) & 0xffffff;
+
+        /* bit19 0->1 => clock LFSR; bit23 0->1 => sync */
+        if (stepNow == toNoise)
+            clockNoise(ch);
+        if (stepNow == toSync)
+            ch->doSync = true;
+
+        left -= stepNow;
+    }
+}
 
-            /* Noise bit crossing? (bit19 => 0x80000) */
-            if (ch->waveform & 0x80)
-            {
-                unsigned mask20 = (ch->accumulator & 0xfffff);
-                if (mask20 < 0x80000)
-                {
-                    int needed = (int)((0x80000 - mask20) / ch->frequency) + 1;
-                    if (needed < stepNow)
-                        stepNow = needed;
-                }
-                else
-                {
-                    int needed = (int)((0x180000 - mask20) / ch->frequency) + 1;
-                    if (needed < stepNow)
-                        stepNow = needed;
-                }
-            }
+/* ------------------------------------------------------------------
+   Clock all three channels of a chip for 'cycles', cycle-exactly.
+   The next bit-19 (noise) and bit-23 (sync source) rising edges of
+   all oscillators form one event schedule: every channel advances
+   straight to the earliest event, the event is applied there (LFSR
+   shift, or resetting the sync target), and only the channels that
+   event touched have their next edge recomputed.
+   ------------------------------------------------------------------ */
+void sidClockChannels(sid_t *sid, int cycles)
+{
+    sidChannel_t *ch = sid->channels;
+    int toNoise[3];
+    int toSync[3];
+    bool running[3];
+    bool anyEdge = false;
+    int i;
 
-            /* Sync detection? (bit23 => 0x800000) */
-            if (ch->syncTarget->waveform & 0x02)
-            {
-                if (ch->accumulator < 0x800000)
-                {
-                    int needed = (int)((0x800000 - ch->accumulator) / ch->frequency) + 1;
-                    if (needed < stepNow)
-                        stepNow = needed;
-                }
-                else
-                {
-                    int needed = (int)((0x1800000 - ch->accumulator) / ch->frequency) + 1;
-                    if (needed < stepNow)
-                        stepNow = needed;
-                }
-            }
+    if (cycles <= 0)
+        return;
 
-            ch->accumulator = (ch->accumulator +
-                               (ch->frequency * (unsigned)stepNow)) &
-                              0xffffff;
+    for (i = 0; i < 3; i++)
+    {
+        clockEnvelope(&ch[i], cycles);
+        if (ch[i].waveform & 0x08) /* test bit */
+            ch[i].accumulator = 0;
+        running[i] = !(ch[i].waveform & 0x08) && ch[i].frequency != 0;
+    }
 
-            /* If noise bit crosses 0->1 in bit19, update LFSR */
-            if (ch->waveform & 0x80)
-            {
-                bool wasLow = ((lastAcc & 0x80000) == 0);
-                bool nowHigh = ((ch->accumulator & 0x80000) != 0);
-                if (wasLow && nowHigh)
-                {
-                    unsigned tmp = ch->noiseGenerator;
-                    unsigned step = (tmp & 0x400000) ^
-                                    ((tmp & 0x20000) << 5);
-                    tmp <<= 1;
-                    if (step)
-                        tmp |= 1;
-                    ch->noiseGenerator = tmp & 0x7fffff;
-                }
-            }
+    int left = cycles;
+    for (i = 0; i < 3; i++)
+    {
+        toNoise[i] = (running[i] && (ch[i].waveform & 0x80))
+                         ? cyclesToEdge(ch[i].accumulator & 0xfffff, 0x80000, ch[i].frequency, left)
+                         : SID_NO_EDGE;
+        toSync[i] = (running[i] && (sidSyncTarget(&ch[i])->waveform & 0x02))
+                        ? cyclesToEdge(ch[i].accumulator, 0x800000, ch[i].frequency, left)
+                        : SID_NO_EDGE;
+        if (toNoise[i] != SID_NO_EDGE || toSync[i] != SID_NO_EDGE)
+            anyEdge = true;
+    }
 
-            /* 0->1 crossing in bit23 => sync */
-            ch->doSync = false;
-            {
-                bool wasLow = ((lastAcc & 0x800000) == 0);
-                bool nowHigh = ((ch->accumulator & 0x800000) != 0);
-                if (wasLow && nowHigh)
-                    ch->doSync = true;
-            }
+    /* Fast path: no events in the whole span */
+    if (!anyEdge)
+    {
+        for (i = 0; i < 3; i++)
+            if (running[i])
+                ch[i].accumulator = (ch[i].accumulator + ch[i].frequency * (unsigned)cycles) & 0xffffff;
+        return;
+    }
+
+    while (left > 0)
+    {
+        int stepNow = left;
+        for (i = 0; i < 3; i++)
+        {
+            if (toNoise[i] < stepNow)
+                stepNow = toNoise[i];
+            if (toSync[i] < stepNow)
+                stepNow = toSync[i];
+        }
+
+        for (i = 0; i < 3; i++)
+            if (running[i])
+                ch[i].accumulator = (ch[i].accumulator + ch[i].frequency * (unsigned)stepNow) & 0xffffff;
+        left -= stepNow;
+
+        /* Apply this cycle's events */
+        bool crossed[3];
+        for (i = 0; i < 3; i++)
+        {
+            if (toNoise[i] != SID_NO_EDGE)
+                toNoise[i] -= stepNow;
+            if (toNoise[i] == 0)
+                clockNoise(&ch[i]);
+
+            if (toSync[i] != SID_NO_EDGE)
+                toSync[i] -= stepNow;
+            crossed[i] = (toSync[i] == 0);
+        }
+        for (i = 0; i < 3; i++)
+            if (crossed[i])
+                sidSyncTarget(&ch[i])->accumulator = 0;
 
-            left -= stepNow;
+        /* Reschedule the channels whose edge fired or that were reset */
+        for (i = 0; i < 3; i++)
+        {
+            bool wasReset = crossed[sidSyncSource(&ch[i])->index];
+            if (!running[i] || left == 0)
+                continue;
+            if ((ch[i].waveform & 0x80) && (toNoise[i] == 0 || wasReset))
+                toNoise[i] = cyclesToEdge(ch[i].accumulator & 0xfffff, 0x80000, ch[i].frequency, left);
+            if ((sidSyncTarget(&ch[i])->waveform & 0x02) && (toSync[i] == 0 || wasReset))
+                toSync[i] = cyclesToEdge(ch[i].accumulator, 0x800000, ch[i].frequency, left);
         }
     }
 }
@@ -381,7 +495,7 @@ void dumpSID(int cpuCycles, int32_t maxSamples, const sidRegs_t *regs, sid_t *si
     printf("\033[5;5H\033[1;37m│\033[0m freq1:      \033[1;32m%05d\033[0m pulse1:     \033[1;32m%05d\033[0m waveform1: \033[1;32m%05d\033[0m ad1: \033[1;32m%05d\033[0m sr1: \033[1;32m%05d\033[0m \033[1;37m│\033[0m", regs->freq1, regs->pulse1, regs->waveform1, regs->ad1, regs->sr1);
     printf("\033[6;5H\033[1;37m│\033[0m freq2:      \033[1;32m%05d\033[0m pulse2:     \033[1;32m%05d\033[0m waveform2: \033[1;32m%05d\033[0m ad2: \033[1;32m%05d\033[0m sr2: \033[1;32m%05d\033[0m \033[1;37m│\033[0m", regs->freq2, regs->pulse2, regs->waveform2, regs->ad2, regs->sr2);
     printf("\033[7;5H\033[1;37m│\033[0m cutoff:     \033[1;32m%05d\033[0m filterCtrl: \033[1;32m%05d\033[0m volume:    \033[1;32m%05d\033[0m \033[1;37m                      │\033[0m", regs->cutoff, regs->filterCtrl, regs->volume);
-    printf("\033[8;5H\033[1;37m│\033[0m cyclesSam:  \033[1;32m%5.4f\033[0m cycleAccumulator: \033[1;32m%5.4f\033[0m \033[1;37m                             │\033[0m", sid->cyclesPerSample, sid->cycleAccumulator);
+    printf("\033[8;5H\033[1;37m│\033[0m cyclesSam:  \033[1;32m%5.4f\033[0m cycleAccumulator: \033[1;32m%5.4f\033[0m \033[1;37m                             │\033[0m", (double)sid->cyclesPerSample / SID_PHASE_ONE, (double)sid->cycleAccumulator / SID_PHASE_ONE);
     printf("\033[9;5H\033[1;37m│\033[0m filter.low: \033[1;32m%5.4f\033[0m filter.band:      \033[1;32m%5.4f\033[0m \033[1;37m                               │\033[0m", sid->filter.low, sid->filter.band);
     printf("\033[10;5H\033[1;37m└────────────────────────────────────────────────────────────────────────────┘\033[0m");
 
@@ -396,36 +510,16 @@ void dumpSID(int cpuCycles, int32_t maxSamples, const sidRegs_t *regs, sid_t *si
         printf("\033[%d;5H%s│\033[0m channels[%d].frequency:   \033[1;32m%05d\033[0m pulse:          \033[1;32m%05d\033[0m waveform:    \033[1;32m%05d\033[0m ad:             \033[1;32m%05d\033[0m sr: \033[1;32m%05d\033[0m %s   │\033[0m", baseRow + 1, color, i, sid->channels[i].frequency, sid->channels[i].pulse, sid->channels[i].waveform, sid->channels[i].ad, sid->channels[i].sr, color);
         printf("\033[%d;5H%s│\033[0m channels[%d].doSync:      \033[1;32m%05d\033[0m state:          \033[1;32m%05d\033[0m accumulator: \033[1;32m%08d\033[0m noiseGenerator: \033[1;32m%05d\033[0m %s        │\033[0m", baseRow + 2, color, i, sid->channels[i].doSync, sid->channels[i].state, sid->channels[i].accumulator, sid->channels[i].noiseGenerator, color);
         printf("\033[%d;5H%s│\033[0m channels[%d].adsrCounter: \033[1;32m%05d\033[0m adsrExpCounter: \033[1;32m%05d\033[0m volumeLevel: \033[1;32m%05d\033[0m %s                                   │\033[0m", baseRow + 3, color, i, sid->channels[i].adsrCounter, sid->channels[i].adsrExpCounter, sid->channels[i].volumeLevel, color);
-        printf("\033[%d;5H%s│\033[0m channels[%d].syncTarget:  \033[1;32m%p\033[0m        syncSource:       \033[1;32m%p\033[0m %s                           │\033[0m", baseRow + 4, color, i, sid->channels[i].syncTarget, sid->channels[i].syncSource, color);
+        printf("\033[%d;5H%s│\033[0m channels[%d].syncTarget:  \033[1;32m%05d\033[0m syncSource:     \033[1;32m%05d\033[0m %s                                                       │\033[0m", baseRow + 4, color, i, sidSyncTarget(&sid->channels[i])->index, sidSyncSource(&sid->channels[i])->index, color);
         printf("\033[%d;5H%s└────────────────────────────────────────────────────────────────────────────────────────────────────────────┘\033[0m", baseRow + 5, color);
     }
 }
 
 /* ------------------------------------------------------------------
-   Advance SID by cpuCycles, produce audio samples in outSamples
-   Returns number of samples written (up to maxSamples).
+   Copy the per-channel register values into the chip
    ------------------------------------------------------------------ */
-int32_t bufferSamplesSid(sid_t *sid,
-                         int cpuCycles,
-                         const sidRegs_t *regs,
-                         void *outSamples,
-                         int32_t maxSamples,
-                         int bufferType,
-                         bool zeroBuffer)
+void sidSetRegs(sid_t *sid, const sidRegs_t *regs)
 {
-    int32_t outIndex = 0;
-    if (cpuCycles <= 0 || maxSamples <= 0)
-        return 0;
-    assert(bufferType == BUFFER_INT16 || bufferType == BUFFER_FLOAT);
-    assert(outSamples);
-    assert(regs);
-    assert(sid);
-
-#ifdef DEBUG
-    dumpSID(cpuCycles, maxSamples, regs, sid);
-#endif
-
-    /* 1) Update channel register values from sidRegs_t */
     sid->channels[0].frequency = (uint16_t)regs->freq0;
     sid->channels[0].pulse = (uint16_t)regs->pulse0;
     sid->channels[0].waveform = (uint8_t)regs->waveform0;
@@ -443,17 +537,23 @@ int32_t bufferSamplesSid(sid_t *sid,
     sid->channels[2].waveform = (uint8_t)regs->waveform2;
     sid->channels[2].ad = (uint8_t)regs->ad2;
     sid->channels[2].sr = (uint8_t)regs->sr2;
+}
 
-    /* The volume register also encodes filter bits (0x70) + vol in lower nibble */
-    float masterVol = (float)((regs->volume) & 0x0f) / 22.5f;
-    uint8_t filterSel = ((uint8_t)regs->volume) & 0x70; /* bits 4..6 */
-    uint8_t filterCtrl = (uint8_t)regs->filterCtrl;
-
-    /* The code uses only the low byte of cutoff (regs->cutoff). */
-    float cutoff = 0.05f + 0.85f * (sinf(((float)regs->cutoff / 255.f - 0.5f) * (float)M_PI) * 0.5f + 0.5f);
-    cutoff = powf(cutoff, 1.3f);
+/* ------------------------------------------------------------------
+   Filter cutoff (0..1) for a cutoff register value.
+   The code uses only the low byte of cutoff (regs->cutoff).
+   ------------------------------------------------------------------ */
+float sidCutoffFromReg(int8_t cutoffReg)
+{
+    float cutoff = 0.05f + 0.85f * (sinf(((float)cutoffReg / 255.f - 0.5f) * (float)M_PI) * 0.5f + 0.5f);
+    return powf(cutoff, 1.3f);
+}
 
-    /* Resonance from upper nibble of filterCtrl if >0x3f, else default. */
+/* ------------------------------------------------------------------
+   Resonance from upper nibble of filterCtrl if >0x3f, else default.
+   ------------------------------------------------------------------ */
+float sidResonanceFromReg(uint8_t filterCtrl)
+{
     float resonance = 1.75f;
     if (filterCtrl > 0x3f)
     {
@@ -461,66 +561,268 @@ int32_t bufferSamplesSid(sid_t *sid,
         if (r > 0)
             resonance = 7.f / (float)r;
     }
+    return resonance;
+}
 
-    /* 2) Step through CPU cycles, generate samples after enough accumulates. */
-    while (cpuCycles > 0 && outIndex < maxSamples)
+/* ------------------------------------------------------------------
+   Derive the mixer/filter settings from the global registers
+   ------------------------------------------------------------------ */
+void sidMixFromRegs(const sidRegs_t *regs, sidMix_t *mix)
+{
+    /* The volume register also encodes filter bits (0x70) + vol in lower nibble */
+    mix->masterVol = (float)((regs->volume) & 0x0f) / 22.5f;
+    mix->filterSel = ((uint8_t)regs->volume) & 0x70; /* bits 4..6 */
+    mix->filterCtrl = (uint8_t)regs->filterCtrl;
+    mix->cutoff = sidCutoffFromReg(regs->cutoff);
+    mix->resonance = sidResonanceFromReg(mix->filterCtrl);
+}
+
+/* ------------------------------------------------------------------
+   Advance SID by cpuCycles, produce audio samples in outSamples
+   Returns number of samples written (up to maxSamples).
+   outSamples may be NULL to only advance the chip state; the return
+   value is then the number of samples that would have been written.
+   ------------------------------------------------------------------ */
+int32_t bufferSamplesSid(sid_t *sid,
+                         int cpuCycles,
+                         const sidRegs_t *regs,
+                         void *outSamples,
+                         int32_t maxSamples,
+                         int bufferType,
+                         bool zeroBuffer)
+{
+    sidMix_t mix;
+    if (cpuCycles <= 0 || maxSamples <= 0)
+        return 0;
+    assert(regs);
+    assert(sid);
+
+#ifdef DEBUG
+    dumpSID(cpuCycles, maxSamples, regs, sid);
+#endif
+
+    /* 1) Update channel register values from sidRegs_t */
+    sidSetRegs(sid, regs);
+    sidMixFromRegs(regs, &mix);
+
+    return sidRenderMix(sid, cpuCycles, &mix, outSamples, maxSamples,
+                        bufferType, zeroBuffer);
+}
+
+/* ------------------------------------------------------------------
+   Event row decoding. 'values' holds the SID_NUM_REG_FIELDS register
+   values of a row (the row without its cycles column); each is
+   truncated to its field's width.
+   ------------------------------------------------------------------ */
+#define COUNT_FIELD(f) +1
+SID_STATIC_ASSERT((0 SID_REG_FIELDS(COUNT_FIELD)) == SID_NUM_REG_FIELDS,
+                  "SID_NUM_REG_FIELDS must match SID_REG_FIELDS");
+#undef COUNT_FIELD
+
+void sidRegsFromRow(sidRegs_t *regs, const int32_t *values)
+{
+    int i = 0;
+    assert(regs);
+    assert(values);
+    memset(regs, 0, sizeof(*regs));
+#define FROM_ROW(f) regs->f = values[i++];
+    SID_REG_FIELDS(FROM_ROW)
+#undef FROM_ROW
+}
+
+void sidEventFromRow(sidEvent_t *event, const int32_t *row)
+{
+    assert(event);
+    assert(row);
+    sidRegsFromRow(&event->regs, row + 1);
+    event->cycles = row[0];
+}
+
+/* ------------------------------------------------------------------
+   Render a register-event stream: each event's registers are applied
+   and the chip is run for its cycles, as successive bufferSamplesSid
+   calls would. Stops once maxSamples have been written.
+   ------------------------------------------------------------------ */
+int32_t sidRenderEvents(sid_t *sid,
+                        const sidEvent_t *events,
+                        int32_t numEvents,
+                        void *outSamples,
+                        int32_t maxSamples,
+                        int bufferType)
+{
+    int32_t produced = 0;
+    size_t sampleSize = (bufferType == BUFFER_INT16) ? sizeof(int16_t) : sizeof(float);
+    assert(events || numEvents == 0);
+
+    for (int32_t i = 0; i < numEvents && produced < maxSamples; i++)
     {
-        /* how many cycles until next sample? */
-        float needed = sid->cyclesPerSample - sid->cycleAccumulator;
-        if (needed < 0.f)
-            needed = 0.f;
-        int stepNow = (cpuCycles < (int)ceilf(needed)) ? cpuCycles : (int)ceilf(needed);
-
-        /* Clock each channel */
-        clockSidChannel(&sid->channels[0], stepNow);
-        clockSidChannel(&sid->channels[1], stepNow);
-        clockSidChannel(&sid->channels[2], stepNow);
-
-        /* Apply sync if doSync is set and target has sync-bit (0x2) */
+        void *dst = outSamples ? (char *)outSamples + (size_t)produced * sampleSize : NULL;
+        produced += bufferSamplesSid(sid, events[i].cycles, &events[i].regs, dst,
+                                     maxSamples - produced, bufferType, true);
+    }
+    return produced;
+}
+
+/* The render kernel, one loop per output format and mode */
+#define SID_RENDER_VARIANT(name, type, zero)                                                   \
+    static int32_t name(sid_t *sid, int cpuCycles, const sidMix_t *mix, void *outSamples,      \
+                        int32_t maxSamples)                                                    \
+    {                                                                                          \
+        return sidRenderKernel(sid, cpuCycles, mix, outSamples, maxSamples, type, zero);       \
+    }
+SID_RENDER_VARIANT(renderInt16, BUFFER_INT16, true)
+SID_RENDER_VARIANT(renderInt16Add, BUFFER_INT16, false)
+SID_RENDER_VARIANT(renderFloat, BUFFER_FLOAT, true)
+SID_RENDER_VARIANT(renderFloatAdd, BUFFER_FLOAT, false)
+#undef SID_RENDER_VARIANT
+
+/* ------------------------------------------------------------------
+   Render with the channel registers already set and the mixer
+   settings precomputed. Same contract as bufferSamplesSid.
+   ------------------------------------------------------------------ */
+int32_t sidRenderMix(sid_t *sid,
+                     int cpuCycles,
+                     const sidMix_t *mix,
+                     void *outSamples,
+                     int32_t maxSamples,
+                     int bufferType,
+                     bool zeroBuffer)
+{
+    return sidRenderTaps(sid, cpuCycles, mix, outSamples, maxSamples,
+                         bufferType, zeroBuffer, NULL);
+}
+
+/* ------------------------------------------------------------------
+   sidRenderMix with optional extra consumers of each rendered sample
+   (taps may be NULL). With taps attached, every sample is mixed even
+   when outSamples is NULL.
+   ------------------------------------------------------------------ */
+int32_t sidRenderTaps(sid_t *sid,
+                      int cpuCycles,
+                      const sidMix_t *mix,
+                      void *outSamples,
+                      int32_t maxSamples,
+                      int bufferType,
+                      bool zeroBuffer,
+                      const sidTaps_t *taps)
+{
+    int32_t outIndex = 0;
+    if (cpuCycles <= 0 || maxSamples <= 0)
+        return 0;
+    assert(bufferType == BUFFER_INT16 || bufferType == BUFFER_FLOAT);
+    assert(mix);
+    assert(sid);
+
+    float masterVol = mix->masterVol;
+    const uint8_t filterSel = mix->filterSel;
+    const uint8_t filterCtrl = mix->filterCtrl;
+    float cutoff = mix->cutoff;
+    const float resonance = mix->resonance;
+    sidAnalysis_t *const analysis = taps ? taps->analysis : NULL;
+    sidAutomation_t *const automation = taps ? taps->automation : NULL;
+    sidStems_t *const stems = taps ? taps->stems : NULL;
+    const bool stateOnly = !outSamples && !analysis && !stems;
+
+    /* Plain output: the kernel for this format and mode */
+    if (outSamples && !analysis && !automation && !stems)
+    {
+        if (bufferType == BUFFER_INT16)
+            return zeroBuffer ? renderInt16(sid, cpuCycles, mix, outSamples, maxSamples)
+                              : renderInt16Add(sid, cpuCycles, mix, outSamples, maxSamples);
+        return zeroBuffer ? renderFloat(sid, cpuCycles, mix, outSamples, maxSamples)
+                          : renderFloatAdd(sid, cpuCycles, mix, outSamples, maxSamples);
+    }
+
+    /* Automated values override the registers for this call */
+    if (automation)
+    {
+        sidMix_t cur = *mix;
+        sidAutomationApply(automation, sid, &cur);
+        masterVol = cur.masterVol;
+        cutoff = cur.cutoff;
+    }
+
+    /* State-only with the filter at rest: nothing depends on the
+       per-sample voice outputs, and channel clocking is exact however
+       it is split, so count the samples on the phase alone and clock
+       the chip once for the whole span. */
+    if (stateOnly && !automation && !(filterCtrl & 0x07) &&
+        sid->filter.low == 0.f && sid->filter.band == 0.f)
+    {
+        int consumed = 0;
+        while (cpuCycles > 0 && outIndex < maxSamples)
         {
-            for (int i = 0; i < 3; i++)
+            int stepNow = sidKernelStep(sid, cpuCycles);
+            sid->cycleAccumulator += (uint64_t)stepNow << SID_PHASE_BITS;
+            if (sid->cycleAccumulator >= sid->cyclesPerSample)
             {
-                if (sid->channels[i].doSync &&
-                    (sid->channels[i].syncTarget->waveform & 0x02))
-                {
-                    /* resetAccumulatorSidChannel(...) => ch->accumulator = 0; */
-                    sid->channels[i].syncTarget->accumulator = 0;
-                }
+                sid->cycleAccumulator -= sid->cyclesPerSample;
+                outIndex++;
             }
+            consumed += stepNow;
+            cpuCycles -= stepNow;
         }
+        sidClockChannels(sid, consumed);
+        return outIndex;
+    }
+
+    /* 2) Step through CPU cycles, generate samples after enough accumulates. */
+    while (cpuCycles > 0 && outIndex < maxSamples)
+    {
+        /* how many whole cycles until next sample? (rounded up) */
+        int stepNow = sidKernelStep(sid, cpuCycles);
 
-        sid->cycleAccumulator += stepNow;
+        /* Clock all channels, applying sync exactly where it occurs */
+        sidClockChannels(sid, stepNow);
+        if (automation)
+            automation->cycle += (uint64_t)stepNow;
+
+        sid->cycleAccumulator += (uint64_t)stepNow << SID_PHASE_BITS;
         if (sid->cycleAccumulator >= sid->cyclesPerSample)
         {
             sid->cycleAccumulator -= sid->cyclesPerSample;
 
-            /* 3) Mix channels with filter routing. */
-            float out = 0.f;
-            float fin = 0.f;
-
-            /* channel0 -> filter or direct? */
+            /* Automation moves on sample boundaries only */
+            if (automation && automation->cycle >= automation->nextChange)
             {
-                float c0 = getOutputSidChannel(&sid->channels[0]);
-                if (filterCtrl & 0x01)
-                    fin += c0;
-                else
-                    out += c0;
+                sidMix_t cur = *mix;
+                sidAutomationUpdate(automation);
+                sidAutomationApply(automation, sid, &cur);
+                masterVol = cur.masterVol;
+                cutoff = cur.cutoff;
             }
-            /* channel1 */
+
+            if (stateOnly)
             {
-                float c1 = getOutputSidChannel(&sid->channels[1]);
-                if (filterCtrl & 0x02)
-                    fin += c1;
-                else
-                    out += c1;
+                /* State-only: the filter is the only state fed by the
+                   voices; it stays at rest while nothing is routed in */
+                if ((filterCtrl & 0x07) || sid->filter.low != 0.f || sid->filter.band != 0.f)
+                {
+                    float fin = 0.f;
+                    float filtered;
+                    for (int i = 0; i < 3; i++)
+                        if (filterCtrl & (1 << i))
+                            fin += getOutputSidChannel(&sid->channels[i]);
+                    sidFilterStep(fin, cutoff, resonance, filterSel, &sid->filter, &filtered);
+                }
+                outIndex++;
+                cpuCycles -= stepNow;
+                continue;
             }
-            /* channel2 */
+
+            /* 3) Mix channels with filter routing. */
+            float out = 0.f;
+            float fin = 0.f;
+            float voice[3];
+
+            /* channel i -> filter (filterCtrl bit i) or direct? */
+            for (int i = 0; i < 3; i++)
             {
-                float c2 = getOutputSidChannel(&sid->channels[2]);
-                if (filterCtrl & 0x04)
-                    fin += c2;
+                voice[i] = getOutputSidChannel(&sid->channels[i]);
+                if (filterCtrl & (1 << i))
+                    fin += voice[i];
                 else
-                    out += c2;
+                    out += voice[i];
             }
 
             /* Filter the mixed channels */
@@ -535,7 +837,19 @@ int32_t bufferSamplesSid(sid_t *sid,
             if (out > 1.f)
                 out = 1.f;
 
-            if (zeroBuffer)
+            if (analysis)
+                sidAnalysisSample(analysis, sid, out);
+            if (stems)
+            {
+                sidMix_t cur = *mix;
+                cur.masterVol = masterVol;
+                cur.cutoff = cutoff;
+                sidStemsSample(stems, &cur, voice, filtered, out);
+            }
+
+            if (!outSamples)
+                outIndex++;
+            else if (zeroBuffer)
             {
                 if (bufferType == BUFFER_INT16)
                     ((int16_t *)outSamples)[outIndex++] = (int16_t)(out * 32767.f);
@@ -557,11 +871,6 @@ int32_t bufferSamplesSid(sid_t *sid,
     return outIndex; /* number of samples produced */
 }
 
-static float saturate(float x)
-{
-    return x - (x * x * x) / 6.0f;
-}
-
 /*
    sidFilterStep: A simple 2-pole resonant state-variable filter.
    - in         : input signal (e.g. sum of channels that go through the filter).
@@ -574,35 +883,135 @@ static float saturate(float x)
 void sidFilterStep(float in, float cutoff, float resonance, uint8_t filterSel,
                    filterState_t *st, float *out)
 {
-    /* 1) Subtract some of the bandpass signal for resonance feedback. */
-    float input = in - (resonance * st->band);
-
-    /* 2) Integrator #1 => "low" output. */
-    st->low += saturate(cutoff * st->band);
-
-    /* 3) Integrator #2 => "band" output. */
-    st->band += saturate(cutoff * (input - st->low));
-
-    /* 4) The highpass output is what's "left over": input - (low + band). */
-    /*   (In some variations, you might do input - low - Q*band, etc.) */
-    float high = input - st->low - st->band;
-
-    /* 5) Combine whichever modes are requested:
-          bit 0x10 => Lowpass
-          bit 0x20 => Bandpass
-          bit 0x40 => Highpass
-       This part is up to you; you can accumulate them any way you like.
-    */
-    float mix = 0.f;
-    if (filterSel & 0x10) /* Lowpass bit */
-        mix += st->low;
-    if (filterSel & 0x20) /* Bandpass bit */
-        mix += st->band;
-    if (filterSel & 0x40) /* Highpass bit */
-        mix += high;
-
-    /* 6) Write the mixed result */
-    *out = mix;
+    *out = sidKernelFilter(in, cutoff, resonance, filterSel, st);
+}
+
+/* ------------------------------------------------------------------
+   Chip arena
+   One aligned block of 'capacity' chips plus a stack of free slot
+   indices. Chips hold no pointers, so sidArenaClone is a plain copy.
+   ------------------------------------------------------------------ */
+bool sidArenaInit(sidArena_t *arena, uint32_t capacity)
+{
+    assert(arena);
+    assert(capacity > 0);
+    arena->slots = (sid_t *)aligned_alloc(SID_ALIGN, (size_t)capacity * sizeof(sid_t));
+    arena->freeList = (uint32_t *)malloc((size_t)capacity * sizeof(uint32_t));
+    arena->inUse = (uint8_t *)malloc(capacity);
+    if (!arena->slots || !arena->freeList || !arena->inUse)
+    {
+        free(arena->slots);
+        free(arena->freeList);
+        free(arena->inUse);
+        arena->slots = NULL;
+        arena->freeList = NULL;
+        arena->inUse = NULL;
+        arena->capacity = 0;
+        arena->freeCount = 0;
+        return false;
+    }
+    arena->capacity = capacity;
+    sidArenaFreeAll(arena);
+    return true;
+}
+
+void sidArenaDestroy(sidArena_t *arena)
+{
+    assert(arena);
+    free(arena->slots);
+    free(arena->freeList);
+    free(arena->inUse);
+    arena->slots = NULL;
+    arena->freeList = NULL;
+    arena->inUse = NULL;
+    arena->capacity = 0;
+    arena->freeCount = 0;
+}
+
+/* Pop a slot without initialising it */
+static sid_t *sidArenaTake(sidArena_t *arena)
+{
+    if (arena->freeCount == 0)
+        return NULL;
+    uint32_t slot = arena->freeList[--arena->freeCount];
+    arena->inUse[slot] = 1;
+    return &arena->slots[slot];
+}
+
+sid_t *sidArenaAlloc(sidArena_t *arena, int32_t sampleRate)
+{
+    assert(arena);
+    sid_t *sid = sidArenaTake(arena);
+    if (sid)
+        sidInit(sid, sampleRate);
+    return sid;
+}
+
+sid_t *sidArenaClone(sidArena_t *arena, const sid_t *src)
+{
+    assert(arena);
+    assert(src);
+    sid_t *sid = sidArenaTake(arena);
+    if (sid)
+        memcpy(sid, src, sizeof(*sid));
+    return sid;
+}
+
+/* Returns the number of chips actually allocated (may be < count) */
+uint32_t sidArenaAllocBulk(sidArena_t *arena, sid_t **out, uint32_t count,
+                           int32_t sampleRate)
+{
+    uint32_t i;
+    assert(arena);
+    assert(out);
+    for (i = 0; i < count; i++)
+    {
+        out[i] = sidArenaAlloc(arena, sampleRate);
+        if (!out[i])
+            break;
+    }
+    return i;
+}
+
+void sidArenaFree(sidArena_t *arena, sid_t *sid)
+{
+    assert(arena);
+    if (!sid)
+        return;
+    uintptr_t offset = (uintptr_t)sid - (uintptr_t)arena->slots;
+    bool owned = sid >= arena->slots && sid < arena->slots + arena->capacity &&
+                 offset % sizeof(sid_t) == 0;
+    assert(owned && "sidArenaFree: pointer not from this arena");
+    if (!owned)
+        return;
+
+    uint32_t slot = (uint32_t)(offset / sizeof(sid_t));
+    assert(arena->inUse[slot] && "sidArenaFree: slot already free");
+    if (!arena->inUse[slot])
+        return;
+    arena->inUse[slot] = 0;
+    arena->freeList[arena->freeCount++] = slot;
+}
+
+void sidArenaFreeAll(sidArena_t *arena)
+{
+    uint32_t i;
+    assert(arena);
+    /* Lowest slots are handed out first */
+    for (i = 0; i < arena->capacity; i++)
+    {
+        arena->freeList[i] = arena->capacity - 1 - i;
+        arena->inUse[i] = 0;
+    }
+    arena->freeCount = arena->capacity;
+}
+
+/* Total bytes owned by the arena, including bookkeeping */
+size_t sidArenaBytes(const sidArena_t *arena)
+{
+    assert(arena);
+    return sizeof(*arena) +
+           (size_t)arena->capacity * (sizeof(sid_t) + sizeof(uint32_t) + sizeof(uint8_t));
 }
 
 /* ------------------------------------------------------------------
@@ -3,11 +3,25 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
 #include <assert.h>
 
+/* ------------------------------------------------------------------
+   Usable from C++ (see simple_sid.hpp)
+   ------------------------------------------------------------------ */
+#ifdef __cplusplus
+#define SID_ALIGNAS(n) alignas(n)
+#define SID_STATIC_ASSERT(cond, msg) static_assert(cond, msg)
+extern "C" {
+#else
+#define SID_ALIGNAS(n) _Alignas(n)
+#define SID_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
+#endif
+
 /* ------------------------------------------------------------------
    If your environment doesn't define M_PI:
    ------------------------------------------------------------------ */
@@ -15,6 +29,17 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+/* ------------------------------------------------------------------
+   Clock and sample timing. Sample scheduling uses a 32.32 fixed-point
+   cycle phase, so long renders do not drift and the sample instants do
+   not depend on how the caller splits cpuCycles into blocks. The
+   output itself is split-independent because sidClockChannels clocks
+   every noise/sync edge exactly (checked by 'make check').
+   ------------------------------------------------------------------ */
+#define SID_CLOCK_PAL (63 * 312 * 50)
+#define SID_PHASE_BITS 32
+#define SID_PHASE_ONE ((uint64_t)1 << SID_PHASE_BITS)
+
 #define BUFFER_INVALID 0 
 #define BUFFER_INT16 1
 #define BUFFER_FLOAT 2
@@ -24,6 +49,19 @@ typedef struct {
     float band;
 } filterState_t;
 
+/* ------------------------------------------------------------------
+   ADSR tables, as initialiser lists so that simple_sid.c and the
+   constexpr copies in simple_sid.hpp come from one place: cycles per
+   envelope step for each rate nibble, and the sustain level for each
+   sustain nibble.
+   ------------------------------------------------------------------ */
+#define SID_ADSR_RATES \
+    9, 32, 63, 95, 149, 220, 267, 313, \
+    392, 977, 1954, 3126, 3907, 11720, 19532, 31251
+#define SID_SUSTAIN_LEVELS \
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, \
+    0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+
 /* ------------------------------------------------------------------
    ADSR (Attack/Decay/Release) states
    ------------------------------------------------------------------ */
@@ -36,37 +74,74 @@ typedef enum
 
 /* ------------------------------------------------------------------
    One SID channel
+   Fields are ordered widest first so the struct has no padding.
+   There are no pointers: the sync/ring-mod neighbours are found from
+   'index', so a chip can be copied or moved with memcpy.
    ------------------------------------------------------------------ */
 typedef struct sidChannel_s
 {
+    unsigned accumulator;    /* 24-bit, in a 32-bit unsigned */
+    unsigned noiseGenerator; /* up to 23 bits used */
     uint16_t frequency;
+    uint16_t pulse;
+    uint16_t adsrCounter;
     uint8_t ad; /* Attack= high nibble, Decay= low nibble */
     uint8_t sr; /* Sustain= high nibble, Release= low nibble */
-    uint16_t pulse;
     uint8_t waveform;
+    uint8_t state; /* adsrState_t */
     bool doSync;
-    adsrState_t state;
-    unsigned accumulator;    /* 24-bit, in a 32-bit unsigned */
-    unsigned noiseGenerator; /* up to 23 bits used */
-    uint16_t adsrCounter;
     uint8_t adsrExpCounter;
     uint8_t volumeLevel;
-
-    struct sidChannel_s *syncTarget;
-    struct sidChannel_s *syncSource;
+    uint8_t index; /* position in sid_t.channels[] (0..2) */
+    uint8_t reserved[2];
 } sidChannel_t;
 
+SID_STATIC_ASSERT(sizeof(sidChannel_t) == 24, "sidChannel_t must stay unpadded");
+
 /* ------------------------------------------------------------------
    The SID chip itself: 3 channels + filter state + sample stepping
+   Aligned to SID_ALIGN (a cache line by default) so that a chip never
+   straddles more lines than it has to.
    ------------------------------------------------------------------ */
+#ifndef SID_ALIGN
+#define SID_ALIGN 64
+#endif
+
 typedef struct
 {
-    sidChannel_t channels[3];
-    float cyclesPerSample;
-    float cycleAccumulator;
-    filterState_t filter;    
+    SID_ALIGNAS(SID_ALIGN) sidChannel_t channels[3];
+    filterState_t filter;
+    uint64_t cyclesPerSample;  /* 32.32 fixed point */
+    uint64_t cycleAccumulator; /* 32.32 fixed point */
 } sid_t;
 
+/* Channel 0 syncs/ring-mods channel 1, 1 -> 2 and 2 -> 0. */
+static inline sidChannel_t *sidSyncTarget(sidChannel_t *ch)
+{
+    return (ch->index == 2) ? ch - 2 : ch + 1;
+}
+
+static inline sidChannel_t *sidSyncSource(sidChannel_t *ch)
+{
+    return (ch->index == 0) ? ch + 2 : ch - 1;
+}
+
+/* ------------------------------------------------------------------
+   Arena of chips for creating/destroying many instances in bulk.
+   Slots are SID_ALIGN aligned and contiguous; free slots are kept on
+   an index stack, so allocation and release are O(1). Releasing a
+   pointer the arena doesn't own, or a slot that is already free, is
+   caught by an assert (and ignored when asserts are compiled out).
+   ------------------------------------------------------------------ */
+typedef struct
+{
+    sid_t *slots;
+    uint32_t *freeList;
+    uint8_t *inUse; /* per slot: 1 while allocated */
+    uint32_t capacity;
+    uint32_t freeCount;
+} sidArena_t;
+
 /* ------------------------------------------------------------------
    The struct containing register values for each channel and filter.
    For 2-byte fields, use int16_t; for 1-byte fields, use int8_t.
@@ -100,11 +175,65 @@ typedef struct
     int8_t volume;     /* top nibble=filter bits, lower nibble=master vol */
 } sidRegs_t;
 
-void sidChannelInit(sidChannel_t *ch);
+/* ------------------------------------------------------------------
+   One entry of a register-event stream: set 'regs', then run the chip
+   for 'cycles' CPU cycles.
+   ------------------------------------------------------------------ */
+typedef struct
+{
+    sidRegs_t regs;
+    int32_t cycles;
+} sidEvent_t;
+
+/* ------------------------------------------------------------------
+   Flat event rows, as in register logs, the render server and the
+   Python bindings: SID_EVENT_COLUMNS int32 per event, the cycles and
+   then the sidRegs_t fields in declaration order (SID_REG_FIELDS).
+   sidRegs_t has padding between fields, so code that walks the
+   registers uses the X-macro rather than the struct layout.
+   ------------------------------------------------------------------ */
+#define SID_REG_FIELDS(X) \
+    X(freq0) X(pulse0) X(waveform0) X(ad0) X(sr0) \
+    X(freq1) X(pulse1) X(waveform1) X(ad1) X(sr1) \
+    X(freq2) X(pulse2) X(waveform2) X(ad2) X(sr2) \
+    X(cutoff) X(filterCtrl) X(volume)
+#define SID_NUM_REG_FIELDS 18
+#define SID_EVENT_COLUMNS (1 + SID_NUM_REG_FIELDS)
+
+/* ------------------------------------------------------------------
+   Mixer/filter settings derived from the global registers
+   (see sidMixFromRegs).
+   ------------------------------------------------------------------ */
+typedef struct
+{
+    float masterVol;
+    float cutoff;
+    float resonance;
+    uint8_t filterSel;  /* LP/BP/HP bits (0x70) */
+    uint8_t filterCtrl; /* resonance + voice routing bits */
+} sidMix_t;
+
+/* ------------------------------------------------------------------
+   Optional per-sample consumers attached to a render (sidRenderTaps).
+   Any member may be NULL.
+   ------------------------------------------------------------------ */
+typedef struct sidAnalysis_s sidAnalysis_t;
+typedef struct sidAutomation_s sidAutomation_t;
+typedef struct sidStems_s sidStems_t;
+
+typedef struct
+{
+    sidAnalysis_t *analysis;     /* see sid_analysis.h */
+    sidAutomation_t *automation; /* see sid_automation.h */
+    sidStems_t *stems;           /* see sid_stems.h */
+} sidTaps_t;
+
+void sidChannelInit(sidChannel_t *ch, uint8_t index);
 void sidInit(sid_t *sid, int32_t sampleRate);
 unsigned triangleSidChannel(sidChannel_t *ch);
 unsigned noiseSidChannel(sidChannel_t *ch);
 void clockSidChannel(sidChannel_t *ch, int cycles);
+void sidClockChannels(sid_t *sid, int cycles);
 float getOutputSidChannel(sidChannel_t *ch);
 
 int32_t bufferSamplesSid(sid_t *sid,
@@ -114,6 +243,48 @@ int32_t bufferSamplesSid(sid_t *sid,
                          int32_t maxSamples,
                          int bufferType,
                          bool zeroBuffer);
+int32_t sidRenderEvents(sid_t *sid,
+                        const sidEvent_t *events,
+                        int32_t numEvents,
+                        void *outSamples,
+                        int32_t maxSamples,
+                        int bufferType);
+void sidSetRegs(sid_t *sid, const sidRegs_t *regs);
+void sidRegsFromRow(sidRegs_t *regs, const int32_t *values);
+void sidEventFromRow(sidEvent_t *event, const int32_t *row);
+float sidCutoffFromReg(int8_t cutoffReg);
+float sidResonanceFromReg(uint8_t filterCtrl);
+void sidMixFromRegs(const sidRegs_t *regs, sidMix_t *mix);
+int32_t sidRenderMix(sid_t *sid,
+                     int cpuCycles,
+                     const sidMix_t *mix,
+                     void *outSamples,
+                     int32_t maxSamples,
+                     int bufferType,
+                     bool zeroBuffer);
+int32_t sidRenderTaps(sid_t *sid,
+                      int cpuCycles,
+                      const sidMix_t *mix,
+                      void *outSamples,
+                      int32_t maxSamples,
+                      int bufferType,
+                      bool zeroBuffer,
+                      const sidTaps_t *taps);
 void sidFilterStep(float in, float cutoff, float resonance, uint8_t filterSel,
                    filterState_t *st, float *out);
-#endif
\ No newline at end of file
+
+bool sidArenaInit(sidArena_t *arena, uint32_t capacity);
+void sidArenaDestroy(sidArena_t *arena);
+sid_t *sidArenaAlloc(sidArena_t *arena, int32_t sampleRate);
+sid_t *sidArenaClone(sidArena_t *arena, const sid_t *src);
+uint32_t sidArenaAllocBulk(sidArena_t *arena, sid_t **out, uint32_t count,
+                           int32_t sampleRate);
+void sidArenaFree(sidArena_t *arena, sid_t *sid);
+void sidArenaFreeAll(sidArena_t *arena);
+size_t sidArenaBytes(const sidArena_t *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
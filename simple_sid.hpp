@@ -0,0 +1,168 @@
+#ifndef SIMPLE_SID_HPP
+#define SIMPLE_SID_HPP
+
+/* ------------------------------------------------------------------
+   Header-only C++20 layer over the C core.
+
+   sid::render<OutFormat, Mode, NumChips>() renders into a std::span
+   with the output format, overwrite/accumulate mode and chip count
+   fixed at compile time. Every chip count runs the inline kernel of
+   sid_kernel.h with the format and mode as constants, so each
+   configuration compiles to its own loop: a single chip calls
+   sidRenderKernel directly, and several chips (e.g. a 2SID tune) are
+   clocked in lockstep into interleaved frames, one channel per chip.
+   Either way the output is bit-identical to bufferSamplesSid. Nothing
+   allocates.
+
+   Chips rendered together must share a sample rate and have rendered
+   the same cycles so far.
+   ------------------------------------------------------------------ */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include "simple_sid.h"
+#include "sid_kernel.h"
+
+namespace sid
+{
+
+/* The ADSR tables, built from the same macros as the core's static
+   const tables. The envelope itself steps in the C core
+   (clockSidChannel); these are for compile-time queries. */
+inline constexpr std::array<uint16_t, 16> adsrRates = {SID_ADSR_RATES};
+inline constexpr std::array<uint8_t, 16> sustainLevels = {SID_SUSTAIN_LEVELS};
+
+/* Cycles for an attack from silence to full level */
+constexpr uint32_t attackCycles(unsigned attackNibble)
+{
+    return 0xffu * adsrRates[attackNibble & 0x0f];
+}
+
+constexpr uint8_t sustainLevel(unsigned sustainNibble)
+{
+    return sustainLevels[sustainNibble & 0x0f];
+}
+
+/* Replace overwrites the output (zeroBuffer = true), Add mixes into it */
+enum class Mode
+{
+    Replace,
+    Add
+};
+
+/* ------------------------------------------------------------------
+   A chip, initialised on construction. The state has no pointers or
+   owned resources, so chips copy like values (a copy is a clone).
+   ------------------------------------------------------------------ */
+class Chip
+{
+public:
+    explicit Chip(int32_t sampleRate = 44100) : sampleRate_(sampleRate)
+    {
+        sidInit(&state_, sampleRate);
+    }
+
+    void reset() { sidInit(&state_, sampleRate_); }
+    void reset(int32_t sampleRate)
+    {
+        sampleRate_ = sampleRate;
+        reset();
+    }
+
+    int32_t sampleRate() const { return sampleRate_; }
+    sid_t *get() { return &state_; }
+    const sid_t *get() const { return &state_; }
+
+    template <typename OutFormat, Mode M = Mode::Replace>
+    std::size_t render(int cpuCycles, const sidRegs_t &regs, std::span<OutFormat> out);
+
+private:
+    sid_t state_;
+    int32_t sampleRate_;
+};
+
+/* ------------------------------------------------------------------
+   Apply each chip's registers and render up to out.size() / NumChips
+   frames. Returns the number of frames produced.
+   ------------------------------------------------------------------ */
+template <typename OutFormat, Mode M = Mode::Replace, std::size_t NumChips = 1>
+std::size_t render(std::span<Chip, NumChips> chips,
+                   int cpuCycles,
+                   std::span<const sidRegs_t, NumChips> regs,
+                   std::span<OutFormat> out)
+{
+    static_assert(std::is_same_v<OutFormat, int16_t> || std::is_same_v<OutFormat, float>,
+                  "output must be int16_t or float");
+    static_assert(NumChips >= 1 && NumChips != std::dynamic_extent,
+                  "the chip count must be fixed at compile time");
+
+    const std::size_t maxFrames = out.size() / NumChips;
+    if (cpuCycles <= 0 || maxFrames == 0)
+        return 0;
+
+    constexpr int bufferType = std::is_same_v<OutFormat, int16_t> ? BUFFER_INT16 : BUFFER_FLOAT;
+    constexpr bool zeroBuffer = (M == Mode::Replace);
+
+    if constexpr (NumChips == 1)
+    {
+        sidMix_t mix;
+        sidSetRegs(chips[0].get(), &regs[0]);
+        sidMixFromRegs(&regs[0], &mix);
+        const int32_t maxSamples = (maxFrames > INT32_MAX) ? INT32_MAX : (int32_t)maxFrames;
+        return (std::size_t)sidRenderKernel(chips[0].get(), cpuCycles, &mix, out.data(), maxSamples,
+                                            bufferType, zeroBuffer);
+    }
+    else
+    {
+        std::array<sidMix_t, NumChips> mix;
+        for (std::size_t c = 0; c < NumChips; c++)
+        {
+            sidSetRegs(chips[c].get(), &regs[c]);
+            sidMixFromRegs(&regs[c], &mix[c]);
+            assert(chips[c].get()->cyclesPerSample == chips[0].get()->cyclesPerSample &&
+                   chips[c].get()->cycleAccumulator == chips[0].get()->cycleAccumulator);
+        }
+
+        /* The chips are in lockstep, so the first one does the timing */
+        const sid_t &lead = *chips[0].get();
+        std::size_t frame = 0;
+        while (cpuCycles > 0 && frame < maxFrames)
+        {
+            int stepNow = sidKernelStep(&lead, cpuCycles);
+            for (std::size_t c = 0; c < NumChips; c++)
+            {
+                sid_t &sid = *chips[c].get();
+                sidClockChannels(&sid, stepNow);
+                sid.cycleAccumulator += (uint64_t)stepNow << SID_PHASE_BITS;
+            }
+
+            if (lead.cycleAccumulator >= lead.cyclesPerSample)
+            {
+                for (std::size_t c = 0; c < NumChips; c++)
+                {
+                    sid_t &sid = *chips[c].get();
+                    sid.cycleAccumulator -= sid.cyclesPerSample;
+                    sidKernelStore(out.data(), (int32_t)(frame * NumChips + c),
+                                   sidKernelSample(&sid, &mix[c]), bufferType, zeroBuffer);
+                }
+                frame++;
+            }
+
+            cpuCycles -= stepNow;
+        }
+        return frame;
+    }
+}
+
+template <typename OutFormat, Mode M>
+std::size_t Chip::render(int cpuCycles, const sidRegs_t &regs, std::span<OutFormat> out)
+{
+    return sid::render<OutFormat, M, 1>(std::span<Chip, 1>(this, 1), cpuCycles,
+                                        std::span<const sidRegs_t, 1>(&regs, 1), out);
+}
+
+} // namespace sid
+
+#endif